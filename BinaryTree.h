@@ -2,6 +2,12 @@
 #define BINARYTREE_H
 
 #include <functional>
+#include <limits>
+#include <memory>
+#include <stack>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 template <typename T>
 struct BinaryTreeNode
@@ -14,41 +20,288 @@ struct BinaryTreeNode
 };
 
 template <typename T>
-class BinaryTree
+class NodeInterner
 {
    private:
-    BinaryTreeNode<T>* root;
+    struct Key
+    {
+        T value;
+        BinaryTreeNode<T>* left;
+        BinaryTreeNode<T>* right;
+
+        bool operator==(const Key& other) const
+        {
+            return value == other.value && left == other.left && right == other.right;
+        }
+    };
 
-    void destroyTree(BinaryTreeNode<T>* node)
+    struct KeyHash
     {
-        if (node)
+        size_t operator()(const Key& key) const
         {
-            destroyTree(node->left);
-            destroyTree(node->right);
-            delete node;
+            size_t hash = std::hash<T>()(key.value);
+            hash ^= std::hash<BinaryTreeNode<T>*>()(key.left) + 0x9e3779b97f4a7c15ULL +
+                    (hash << 6) + (hash >> 2);
+            hash ^= std::hash<BinaryTreeNode<T>*>()(key.right) + 0x9e3779b97f4a7c15ULL +
+                    (hash << 6) + (hash >> 2);
+            return hash;
         }
+    };
+
+    std::unordered_map<Key, BinaryTreeNode<T>*, KeyHash> table;
+    std::vector<BinaryTreeNode<T>*> nodes;
+    size_t requests;
+
+   public:
+    NodeInterner() : requests(0) {}
+
+    ~NodeInterner()
+    {
+        for (BinaryTreeNode<T>* node : nodes) delete node;
+    }
+
+    NodeInterner(const NodeInterner&) = delete;
+    NodeInterner& operator=(const NodeInterner&) = delete;
+
+    BinaryTreeNode<T>* intern(T value, BinaryTreeNode<T>* left, BinaryTreeNode<T>* right)
+    {
+        requests++;
+        Key key{value, left, right};
+        auto it = table.find(key);
+        if (it != table.end()) return it->second;
+
+        BinaryTreeNode<T>* node = new BinaryTreeNode<T>(value);
+        node->left = left;
+        node->right = right;
+        nodes.push_back(node);
+        table.emplace(key, node);
+        return node;
+    }
+
+    void finish()
+    {
+        std::unordered_map<Key, BinaryTreeNode<T>*, KeyHash>().swap(table);
+        nodes.shrink_to_fit();
     }
 
+    size_t uniqueCount() const { return nodes.size(); }
+
+    size_t requestCount() const { return requests; }
+};
+
+template <typename T>
+class LazyNodeSource
+{
+   public:
+    virtual ~LazyNodeSource() = default;
+
+    virtual size_t nodeCount() const = 0;
+
+    virtual T value(size_t id) const = 0;
+
+    virtual size_t children(size_t id, size_t childIds[2]) const = 0;
+
+    virtual void forEachValue(std::function<void(T)> visit) const = 0;
+
+    virtual size_t memoryBytes() const = 0;
+};
+
+template <typename T>
+class BinaryTree
+{
+   private:
+    BinaryTreeNode<T>* root;
+    std::unique_ptr<NodeInterner<T>> interner;
+    std::unique_ptr<LazyNodeSource<T>> lazySource;
+    std::unordered_map<BinaryTreeNode<T>*, size_t> unexpanded;
+    size_t materialized;
+
+    // Only nodes with two children leave their right child on the stack, so a
+    // chain of any depth is walked with an empty stack.
     void preorderTraversal(BinaryTreeNode<T>* node, std::function<void(T)> visit)
     {
-        if (node)
+        std::vector<BinaryTreeNode<T>*> pending;
+        while (node || !pending.empty())
         {
+            if (!node)
+            {
+                node = pending.back();
+                pending.pop_back();
+            }
+
             visit(node->data);
-            preorderTraversal(node->left, visit);
-            preorderTraversal(node->right, visit);
+            if (node->left && node->right) pending.push_back(node->right);
+            node = node->left ? node->left : node->right;
         }
     }
 
    public:
-    BinaryTree() : root(nullptr) {}
+    // Frees a tree in linear time without recursion or a stack: while the current
+    // node has a left child it is rotated right, and once it has none it is
+    // deleted and its right subtree takes its place. Shared subtrees must not be
+    // passed here; their nodes belong to a NodeInterner.
+    static void destroySubtree(BinaryTreeNode<T>* node)
+    {
+        while (node)
+        {
+            if (node->left)
+            {
+                BinaryTreeNode<T>* left = node->left;
+                node->left = left->right;
+                left->right = node;
+                node = left;
+            }
+            else
+            {
+                BinaryTreeNode<T>* right = node->right;
+                delete node;
+                node = right;
+            }
+        }
+    }
+
+    BinaryTree() : root(nullptr), materialized(0) {}
 
-    ~BinaryTree() { destroyTree(root); }
+    ~BinaryTree()
+    {
+        if (!interner) destroySubtree(root);
+    }
 
     void setRoot(BinaryTreeNode<T>* node) { root = node; }
 
+    void setRoot(BinaryTreeNode<T>* node, std::unique_ptr<NodeInterner<T>> nodeOwner)
+    {
+        root = node;
+        interner = std::move(nodeOwner);
+        if (interner) interner->finish();
+    }
+
+    bool isShared() const { return interner != nullptr; }
+
+    size_t storedNodeCount() const { return interner ? interner->uniqueCount() : 0; }
+
+    bool structurallyEqual(BinaryTreeNode<T>* a, BinaryTreeNode<T>* b) const
+    {
+        if (interner || a == b) return a == b;
+
+        std::stack<std::pair<BinaryTreeNode<T>*, BinaryTreeNode<T>*>> pending;
+        pending.push({a, b});
+        while (!pending.empty())
+        {
+            auto [x, y] = pending.top();
+            pending.pop();
+
+            if (x == y) continue;
+            if (!x || !y || x->data != y->data) return false;
+
+            pending.push({x->left, y->left});
+            pending.push({x->right, y->right});
+        }
+        return true;
+    }
+
+    void setLazySource(std::unique_ptr<LazyNodeSource<T>> source)
+    {
+        if (!interner) destroySubtree(root);
+        interner.reset();
+        unexpanded.clear();
+
+        lazySource = std::move(source);
+        root = new BinaryTreeNode<T>(lazySource->value(0));
+        unexpanded[root] = 0;
+        materialized = 1;
+    }
+
+    bool isLazy() const { return lazySource != nullptr; }
+
+    void expand(BinaryTreeNode<T>* node)
+    {
+        if (!lazySource) return;
+
+        auto it = unexpanded.find(node);
+        if (it == unexpanded.end()) return;
+
+        size_t childIds[2];
+        size_t count = lazySource->children(it->second, childIds);
+        unexpanded.erase(it);
+        materialized += count;
+
+        if (count > 0)
+        {
+            node->left = new BinaryTreeNode<T>(lazySource->value(childIds[0]));
+            unexpanded[node->left] = childIds[0];
+        }
+        if (count > 1)
+        {
+            node->right = new BinaryTreeNode<T>(lazySource->value(childIds[1]));
+            unexpanded[node->right] = childIds[1];
+        }
+    }
+
+    size_t materializedCount() const { return materialized; }
+
+    size_t sourceNodeCount() const { return lazySource ? lazySource->nodeCount() : 0; }
+
+    size_t sourceBytes() const { return lazySource ? lazySource->memoryBytes() : 0; }
+
     BinaryTreeNode<T>* getRoot() const { return root; }
 
-    void traverse(std::function<void(T)> visit) { preorderTraversal(root, visit); }
+    // Preorder walk that numbers nodes in visiting order and reports each node's
+    // parent id and side ('L' or 'R'); the root's parent is the largest size_t. Lazily
+    // opened trees are walked through their source without materializing anything.
+    void forEachNode(std::function<void(size_t, size_t, char, T)> visit)
+    {
+        struct Pending
+        {
+            BinaryTreeNode<T>* node;
+            size_t sourceId;
+            size_t parent;
+            char side;
+        };
+
+        const size_t noParent = std::numeric_limits<size_t>::max();
+        std::vector<Pending> stack;
+        if (lazySource)
+        {
+            stack.push_back({nullptr, 0, noParent, 0});
+        }
+        else if (root)
+        {
+            stack.push_back({root, 0, noParent, 0});
+        }
+
+        size_t nextId = 0;
+        while (!stack.empty())
+        {
+            Pending current = stack.back();
+            stack.pop_back();
+            size_t id = nextId++;
+
+            if (lazySource)
+            {
+                size_t childIds[2];
+                size_t count = lazySource->children(current.sourceId, childIds);
+                visit(id, current.parent, current.side, lazySource->value(current.sourceId));
+                if (count > 1) stack.push_back({nullptr, childIds[1], id, 'R'});
+                if (count > 0) stack.push_back({nullptr, childIds[0], id, 'L'});
+                continue;
+            }
+
+            visit(id, current.parent, current.side, current.node->data);
+            if (current.node->right) stack.push_back({current.node->right, 0, id, 'R'});
+            if (current.node->left) stack.push_back({current.node->left, 0, id, 'L'});
+        }
+    }
+
+    void traverse(std::function<void(T)> visit)
+    {
+        if (lazySource)
+        {
+            lazySource->forEachValue(visit);
+            return;
+        }
+        preorderTraversal(root, visit);
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,139 @@
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+class FileWatcher
+{
+   private:
+    std::string path;
+    std::function<void()> onChange;
+    std::thread worker;
+    std::atomic<bool> running;
+    int inotifyFd;
+    int stopFd;
+
+    void splitPath(std::string& directory, std::string& name) const
+    {
+        size_t slash = path.find_last_of('/');
+        if (slash == std::string::npos)
+        {
+            directory = ".";
+            name = path;
+        }
+        else
+        {
+            directory = slash == 0 ? "/" : path.substr(0, slash);
+            name = path.substr(slash + 1);
+        }
+    }
+
+#ifdef __linux__
+    void run(const std::string& name)
+    {
+        alignas(inotify_event) char buffer[4096];
+        pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+
+        while (running)
+        {
+            if (poll(fds, 2, -1) < 0) continue;
+            if (fds[1].revents & POLLIN) break;
+            if (!(fds[0].revents & POLLIN)) continue;
+
+            ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+            if (length <= 0) continue;
+
+            bool changed = false;
+            for (char* p = buffer; p < buffer + length;)
+            {
+                inotify_event* event = reinterpret_cast<inotify_event*>(p);
+                if (event->len > 0 && name == event->name) changed = true;
+                p += sizeof(inotify_event) + event->len;
+            }
+
+            if (changed && running) onChange();
+        }
+    }
+#endif
+
+   public:
+    FileWatcher(const std::string& file, std::function<void()> callback)
+        : path(file), onChange(callback), running(false), inotifyFd(-1), stopFd(-1)
+    {
+    }
+
+    ~FileWatcher() { stop(); }
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    void start()
+    {
+#ifdef __linux__
+        std::string directory, name;
+        splitPath(directory, name);
+
+        inotifyFd = inotify_init1(IN_CLOEXEC);
+        if (inotifyFd < 0)
+        {
+            throw std::runtime_error("Cannot initialize inotify");
+        }
+
+        // Editors usually replace the file through a rename, so the directory is watched
+        if (inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        {
+            close(inotifyFd);
+            inotifyFd = -1;
+            throw std::runtime_error("Cannot watch directory: " + directory);
+        }
+
+        stopFd = eventfd(0, EFD_CLOEXEC);
+        if (stopFd < 0)
+        {
+            close(inotifyFd);
+            inotifyFd = -1;
+            throw std::runtime_error("Cannot create eventfd");
+        }
+
+        running = true;
+        worker = std::thread([this, name]() { run(name); });
+#else
+        throw std::runtime_error("File watching is only supported on Linux");
+#endif
+    }
+
+    void stop()
+    {
+#ifdef __linux__
+        if (!running) return;
+
+        running = false;
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = write(stopFd, &one, sizeof(one));
+        if (worker.joinable()) worker.join();
+
+        close(inotifyFd);
+        close(stopFd);
+        inotifyFd = -1;
+        stopFd = -1;
+#endif
+    }
+
+    bool isRunning() const { return running; }
+
+    const std::string& getPath() const { return path; }
+};
+
+#endif
\ No newline at end of file
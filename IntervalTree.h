@@ -0,0 +1,203 @@
+#ifndef INTERVALTREE_H
+#define INTERVALTREE_H
+
+#include <functional>
+#include <limits>
+#include <stack>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Parser.h"
+#include "RBTree.h"
+
+template <typename T>
+struct Interval
+{
+    T start;
+    T end;
+
+    // Ordered by start, then by end
+    auto operator<=>(const Interval& other) const = default;
+
+    bool operator==(const Interval& other) const = default;
+
+    bool overlaps(const Interval& other) const
+    {
+        return !(end < other.start) && !(other.end < start);
+    }
+};
+
+template <typename T>
+struct MaxEndAggregate
+{
+    using value_type = T;
+
+    static value_type identity() { return std::numeric_limits<T>::lowest(); }
+
+    static value_type lift(const Interval<T>& key, size_t) { return key.end; }
+
+    static value_type combine(const value_type& a, const value_type& b) { return a < b ? b : a; }
+};
+
+template <typename T>
+class IntervalTree
+{
+   private:
+    using Tree = RBTree<Interval<T>, MaxEndAggregate<T>>;
+    using Node = typename Tree::Node;
+
+    Tree tree;
+
+    static T maxEnd(Node* node)
+    {
+        return node ? node->aggregate : MaxEndAggregate<T>::identity();
+    }
+
+   public:
+    IntervalTree() : tree(true) {}
+
+    void insert(const Interval<T>& interval)
+    {
+        if (interval.end < interval.start)
+        {
+            throw std::invalid_argument("Interval end is before its start");
+        }
+        tree.insert(interval);
+    }
+
+    void remove(const Interval<T>& interval) { tree.remove(interval); }
+
+    size_t size() const { return tree.totalCount(); }
+
+    bool overlaps(const Interval<T>& query) const
+    {
+        Node* node = tree.getRoot();
+        while (node != nullptr)
+        {
+            if (node->data.overlaps(query)) return true;
+
+            if (node->left != nullptr && !(maxEnd(node->left) < query.start))
+            {
+                node = node->left;
+            }
+            else
+            {
+                node = node->right;
+            }
+        }
+        return false;
+    }
+
+    bool overlaps(T point) const { return overlaps(Interval<T>{point, point}); }
+
+    // Visits every stored interval that overlaps query. A subtree is skipped when
+    // its largest end is before query.start, and a right subtree when its node
+    // starts after query.end. With the tree ordered by start and augmented only
+    // with the maximum end, this is the classic O(min(n, k log n)) bound for k
+    // overlaps, not O(log n + k): overlaps scattered below non-overlapping nodes
+    // each cost a descent of their own. An output-sensitive bound would need a
+    // priority search or centered layout next to the tree.
+    void forEachOverlap(const Interval<T>& query,
+                        std::function<void(const Interval<T>&)> visit) const
+    {
+        std::stack<Node*> pending;
+        if (tree.getRoot() != nullptr) pending.push(tree.getRoot());
+
+        while (!pending.empty())
+        {
+            Node* node = pending.top();
+            pending.pop();
+
+            if (maxEnd(node) < query.start) continue;
+
+            if (node->data.overlaps(query))
+            {
+                for (size_t i = 0; i < node->count; i++) visit(node->data);
+            }
+
+            if (node->right != nullptr && !(query.end < node->data.start))
+            {
+                pending.push(node->right);
+            }
+            if (node->left != nullptr)
+            {
+                pending.push(node->left);
+            }
+        }
+    }
+
+    std::vector<Interval<T>> overlapping(const Interval<T>& query) const
+    {
+        std::vector<Interval<T>> result;
+        forEachOverlap(query,
+                       [&result](const Interval<T>& interval) { result.push_back(interval); });
+        return result;
+    }
+
+    void inorderTraversal(std::function<void(Interval<T>)> visit) { tree.inorderTraversal(visit); }
+};
+
+template <typename T>
+class IntervalParser : protected Parser<T>
+{
+   private:
+    using Parser<T>::input;
+    using Parser<T>::pos;
+    using Parser<T>::skipWhitespace;
+    using Parser<T>::parseNumber;
+    using Parser<T>::validateInput;
+
+   public:
+    IntervalParser(const std::string& str) : Parser<T>(str) {}
+
+    std::vector<Interval<T>> parse()
+    {
+        validateInput();
+
+        skipWhitespace();
+
+        if (input.empty() || pos >= input.length())
+        {
+            throw std::runtime_error("Empty input");
+        }
+
+        std::vector<Interval<T>> intervals;
+        while (pos < input.length())
+        {
+            if (input[pos] != '(')
+            {
+                throw std::runtime_error("Expected '('");
+            }
+            pos++;
+
+            T start = parseNumber();
+            T end = parseNumber();
+
+            skipWhitespace();
+
+            if (pos >= input.length())
+            {
+                throw std::runtime_error("Unexpected end of input");
+            }
+
+            if (input[pos] != ')')
+            {
+                throw std::runtime_error("Expected ')' after interval end");
+            }
+            pos++;
+
+            if (end < start)
+            {
+                throw std::runtime_error("Interval end is before its start");
+            }
+            intervals.push_back({start, end});
+
+            skipWhitespace();
+        }
+
+        return intervals;
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,120 @@
+#ifndef LOOKUPCACHE_H
+#define LOOKUPCACHE_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+struct LookupCacheStats
+{
+    size_t slots = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t invalidations = 0;
+
+    double hitRate() const
+    {
+        size_t lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / lookups : 0;
+    }
+};
+
+// Direct-mapped cache of recent lookup results, absent keys included. Slots are
+// packed into 64-byte lines so a probe touches exactly one cache line. Each key
+// can live in a single slot, so invalidating a key is one probe as well.
+// Keys are compared with Equal, which must agree with std::hash<K>.
+template <typename K, typename V>
+class LookupCache
+{
+   private:
+    struct Slot
+    {
+        K key{};
+        V value{};
+        bool valid = false;
+    };
+
+    static constexpr size_t slotsPerLine =
+        sizeof(Slot) >= 64 ? 1 : std::bit_floor(64 / sizeof(Slot));
+
+    struct alignas(64) Line
+    {
+        Slot slots[slotsPerLine];
+    };
+
+    std::unique_ptr<Line[]> lines;
+    size_t mask;
+    int shift;
+    LookupCacheStats stats;
+
+    Slot& slotFor(const K& key) const
+    {
+        // Fibonacci hashing spreads std::hash values that are the key itself
+        uint64_t hash = static_cast<uint64_t>(std::hash<K>{}(key)) * 0x9E3779B97F4A7C15ull;
+        size_t index = static_cast<size_t>(hash >> shift) & mask;
+        return lines[index / slotsPerLine].slots[index % slotsPerLine];
+    }
+
+   public:
+    // The slot count is rounded up to a power of two and to at least one line.
+    LookupCache(size_t slots)
+    {
+        size_t count = std::bit_ceil(slots < slotsPerLine ? slotsPerLine : slots);
+        lines = std::make_unique<Line[]>(count / slotsPerLine);
+        mask = count - 1;
+        shift = 64 - std::countr_zero(count);
+        if (shift == 64) shift = 63;
+        stats.slots = count;
+    }
+
+    template <typename Equal>
+    bool find(const K& key, V& value, Equal equal)
+    {
+        Slot& slot = slotFor(key);
+        if (slot.valid && equal(slot.key, key))
+        {
+            stats.hits++;
+            value = slot.value;
+            return true;
+        }
+        stats.misses++;
+        return false;
+    }
+
+    void store(const K& key, const V& value)
+    {
+        Slot& slot = slotFor(key);
+        slot.key = key;
+        slot.value = value;
+        slot.valid = true;
+    }
+
+    // Drops whatever occupies key's slot; cheaper than comparing the stored key.
+    void invalidate(const K& key)
+    {
+        Slot& slot = slotFor(key);
+        if (slot.valid) stats.invalidations++;
+        slot.valid = false;
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i <= mask; i++)
+        {
+            lines[i / slotsPerLine].slots[i % slotsPerLine].valid = false;
+        }
+    }
+
+    const LookupCacheStats& getStats() const { return stats; }
+
+    void resetStats()
+    {
+        size_t slots = stats.slots;
+        stats = LookupCacheStats();
+        stats.slots = slots;
+    }
+};
+
+#endif
@@ -0,0 +1,221 @@
+#ifndef MEMBERSHIPFILTER_H
+#define MEMBERSHIPFILTER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+struct MembershipFilterStats
+{
+    size_t keys = 0;
+    size_t capacity = 0;
+    size_t blocks = 0;
+    int hashes = 0;
+    double targetRate = 0;
+    double expectedRate = 0;
+    size_t queries = 0;
+    size_t rejected = 0;
+    size_t falsePositives = 0;
+
+    // Share of absent keys that got past the filter, over the lookups seen so far.
+    double observedRate() const
+    {
+        size_t absent = rejected + falsePositives;
+        return absent ? static_cast<double>(falsePositives) / absent : 0;
+    }
+
+    size_t bytes() const { return blocks * 64; }
+};
+
+// Counting Bloom filter blocked into 64-byte lines: a key hashes to one line and
+// sets all of its counters there, so any query costs a single cache-line probe.
+// Each line holds 128 four-bit counters. A counter that reaches 15 sticks there,
+// since after an overflow decrementing it could create false negatives.
+// Keys are hashed with std::hash<K>, so keys that the owner treats as equal
+// must hash equal or lookups give false negatives.
+template <typename K>
+class CountingBloomFilter
+{
+   private:
+    static constexpr int countersPerBlock = 128;
+    static constexpr uint64_t counterMax = 15;
+
+    struct alignas(64) Block
+    {
+        uint64_t words[8];
+    };
+
+    std::unique_ptr<Block[]> blocks;
+    size_t blockCount;
+    int hashes;
+    size_t capacity;
+    double targetRate;
+    size_t keys;
+    mutable size_t queries;
+    mutable size_t rejected;
+    mutable size_t falsePositives;
+
+    static uint64_t mix(uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ull;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBull;
+        x ^= x >> 31;
+        return x;
+    }
+
+    // False-positive rate of k hashes when lines hold keysPerLine keys on average:
+    // the number of keys in the probed line is Poisson distributed, and each key
+    // sets k counters of the 128 chosen independently.
+    static double blockedRate(double keysPerLine, int k)
+    {
+        double probability = std::exp(-keysPerLine);
+        double rate = 0;
+        double limit = keysPerLine + 12 * std::sqrt(keysPerLine) + 20;
+        for (int i = 0; i < limit; i++)
+        {
+            double clear = std::pow(1 - 1.0 / countersPerBlock, static_cast<double>(k) * i);
+            rate += probability * std::pow(1 - clear, k);
+            probability *= keysPerLine / (i + 1);
+        }
+        return rate;
+    }
+
+    // Picks the block from the high half of the hash and takes the counter
+    // positions seven bits at a time from a second hash, remixed every nine
+    // positions. Unlike double hashing, this keeps the positions independent.
+    template <typename Visit>
+    void forEachCounter(const K& key, Visit visit) const
+    {
+        uint64_t hash = mix(static_cast<uint64_t>(std::hash<K>{}(key)));
+        size_t index = static_cast<size_t>(((hash >> 32) * blockCount) >> 32);
+        Block& block = blocks[index];
+        uint64_t bits = 0;
+        for (int i = 0; i < hashes; i++)
+        {
+            if (i % 9 == 0)
+            {
+                hash = mix(hash + 0x9E3779B97F4A7C15ull);
+                bits = hash;
+            }
+            size_t counter = bits % countersPerBlock;
+            bits >>= 7;
+            if (!visit(block.words[counter / 16], (counter % 16) * 4)) return;
+        }
+    }
+
+   public:
+    // Sized so that capacity keys give the target false-positive rate: for every
+    // hash count, the densest load per line that still meets the target is found
+    // by bisection, and the hash count allowing the fewest lines wins.
+    CountingBloomFilter(size_t expectedKeys, double falsePositiveRate)
+        : hashes(1),
+          capacity(std::max<size_t>(expectedKeys, 1)),
+          targetRate(std::clamp(falsePositiveRate, 1e-6, 0.5)),
+          keys(0),
+          queries(0),
+          rejected(0),
+          falsePositives(0)
+    {
+        double bestLoad = 0;
+        for (int k = 1; k <= 16; k++)
+        {
+            double low = 0;
+            double high = countersPerBlock;
+            for (int step = 0; step < 40; step++)
+            {
+                double middle = (low + high) / 2;
+                (blockedRate(middle, k) <= targetRate ? low : high) = middle;
+            }
+            if (low > bestLoad)
+            {
+                bestLoad = low;
+                hashes = k;
+            }
+        }
+        blockCount = static_cast<size_t>(std::ceil(capacity / std::max(bestLoad, 1e-3)));
+        blocks = std::make_unique<Block[]>(blockCount);
+    }
+
+    void insert(const K& key)
+    {
+        forEachCounter(key,
+                       [](uint64_t& word, int shift)
+                       {
+                           if (((word >> shift) & counterMax) != counterMax)
+                           {
+                               word += uint64_t(1) << shift;
+                           }
+                           return true;
+                       });
+        keys++;
+    }
+
+    // Only keys that were inserted may be removed.
+    void remove(const K& key)
+    {
+        forEachCounter(key,
+                       [](uint64_t& word, int shift)
+                       {
+                           uint64_t value = (word >> shift) & counterMax;
+                           if (value != 0 && value != counterMax)
+                           {
+                               word -= uint64_t(1) << shift;
+                           }
+                           return true;
+                       });
+        if (keys > 0) keys--;
+    }
+
+    // False means key was never inserted; true means it probably was.
+    bool mayContain(const K& key) const
+    {
+        bool present = true;
+        forEachCounter(key,
+                       [&present](uint64_t& word, int shift)
+                       {
+                           present = ((word >> shift) & counterMax) != 0;
+                           return present;
+                       });
+        queries++;
+        if (!present) rejected++;
+        return present;
+    }
+
+    // Called when a key that passed mayContain turned out to be absent.
+    void recordFalsePositive() const { falsePositives++; }
+
+    bool isFull() const { return keys >= capacity; }
+
+    size_t getCapacity() const { return capacity; }
+
+    double getTargetRate() const { return targetRate; }
+
+    MembershipFilterStats getStats() const
+    {
+        MembershipFilterStats stats;
+        stats.keys = keys;
+        stats.capacity = capacity;
+        stats.blocks = blockCount;
+        stats.hashes = hashes;
+        stats.targetRate = targetRate;
+        stats.expectedRate = blockedRate(static_cast<double>(keys) / blockCount, hashes);
+        stats.queries = queries;
+        stats.rejected = rejected;
+        stats.falsePositives = falsePositives;
+        return stats;
+    }
+
+    void resetStats()
+    {
+        queries = 0;
+        rejected = 0;
+        falsePositives = 0;
+    }
+};
+
+#endif
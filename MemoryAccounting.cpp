@@ -0,0 +1,175 @@
+#include "MemoryAccounting.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+std::atomic<size_t> MemoryAccounting::liveBytes(0);
+std::atomic<size_t> MemoryAccounting::peakBytes(0);
+std::atomic<size_t> MemoryAccounting::liveBlocks(0);
+std::atomic<size_t> MemoryAccounting::totalAllocations(0);
+
+namespace
+{
+const size_t chunkHeader = sizeof(size_t);
+
+// A function-local static, so that allocations made while other translation
+// units are still being initialized see the final setting too.
+bool tracking()
+{
+    static const bool requested = []()
+    {
+        const char* setting = std::getenv("TREE_MEMORY_ACCOUNTING");
+        return setting != nullptr && setting[0] != '\0' && setting[0] != '0';
+    }();
+    return requested;
+}
+
+void* allocate(size_t bytes)
+{
+    if (!tracking())
+    {
+        void* block = std::malloc(bytes == 0 ? 1 : bytes);
+        if (!block) throw std::bad_alloc();
+        return block;
+    }
+#ifdef __GLIBC__
+    void* block = std::malloc(bytes == 0 ? 1 : bytes);
+    if (!block) throw std::bad_alloc();
+    MemoryAccounting::recordAllocation(malloc_usable_size(block) + chunkHeader);
+    return block;
+#else
+    char* block = static_cast<char*>(std::malloc(bytes + alignof(std::max_align_t)));
+    if (!block) throw std::bad_alloc();
+    *reinterpret_cast<size_t*>(block) = bytes;
+    MemoryAccounting::recordAllocation(MemoryAccounting::footprint(bytes));
+    return block + alignof(std::max_align_t);
+#endif
+}
+
+void release(void* block)
+{
+    if (!block) return;
+    if (!tracking())
+    {
+        std::free(block);
+        return;
+    }
+#ifdef __GLIBC__
+    MemoryAccounting::recordRelease(malloc_usable_size(block) + chunkHeader);
+    std::free(block);
+#else
+    char* start = static_cast<char*>(block) - alignof(std::max_align_t);
+    MemoryAccounting::recordRelease(MemoryAccounting::footprint(*reinterpret_cast<size_t*>(start)));
+    std::free(start);
+#endif
+}
+
+// Over-aligned blocks come from aligned_alloc. Without glibc's usable size the
+// requested size is kept in a header one alignment unit long, which keeps the
+// returned pointer aligned.
+void* allocateAligned(size_t bytes, std::align_val_t alignment)
+{
+    size_t align = static_cast<size_t>(alignment);
+    size_t rounded = ((bytes == 0 ? 1 : bytes) + align - 1) / align * align;
+    if (!tracking())
+    {
+        void* block = std::aligned_alloc(align, rounded);
+        if (!block) throw std::bad_alloc();
+        return block;
+    }
+#ifdef __GLIBC__
+    void* block = std::aligned_alloc(align, rounded);
+    if (!block) throw std::bad_alloc();
+    MemoryAccounting::recordAllocation(malloc_usable_size(block) + chunkHeader);
+    return block;
+#else
+    char* block = static_cast<char*>(std::aligned_alloc(align, rounded + align));
+    if (!block) throw std::bad_alloc();
+    *reinterpret_cast<size_t*>(block) = rounded;
+    MemoryAccounting::recordAllocation(MemoryAccounting::footprint(rounded + align));
+    return block + align;
+#endif
+}
+
+void releaseAligned(void* block, [[maybe_unused]] std::align_val_t alignment)
+{
+    if (!block) return;
+    if (!tracking())
+    {
+        std::free(block);
+        return;
+    }
+#ifdef __GLIBC__
+    MemoryAccounting::recordRelease(malloc_usable_size(block) + chunkHeader);
+    std::free(block);
+#else
+    size_t align = static_cast<size_t>(alignment);
+    char* start = static_cast<char*>(block) - align;
+    MemoryAccounting::recordRelease(
+        MemoryAccounting::footprint(*reinterpret_cast<size_t*>(start) + align));
+    std::free(start);
+#endif
+}
+}
+
+bool MemoryAccounting::isEnabled() { return tracking(); }
+
+size_t MemoryAccounting::footprint(size_t requested)
+{
+#ifdef __GLIBC__
+    void* block = std::malloc(requested == 0 ? 1 : requested);
+    size_t size = malloc_usable_size(block) + chunkHeader;
+    std::free(block);
+    return size;
+#else
+    size_t rounded = (requested + alignof(std::max_align_t) + chunkHeader + 15) / 16 * 16;
+    return rounded < 32 ? 32 : rounded;
+#endif
+}
+
+void* operator new(size_t bytes) { return allocate(bytes); }
+
+void* operator new[](size_t bytes) { return allocate(bytes); }
+
+void operator delete(void* block) noexcept { release(block); }
+
+void operator delete[](void* block) noexcept { release(block); }
+
+void operator delete(void* block, size_t) noexcept { release(block); }
+
+void operator delete[](void* block, size_t) noexcept { release(block); }
+
+void* operator new(size_t bytes, std::align_val_t alignment)
+{
+    return allocateAligned(bytes, alignment);
+}
+
+void* operator new[](size_t bytes, std::align_val_t alignment)
+{
+    return allocateAligned(bytes, alignment);
+}
+
+void operator delete(void* block, std::align_val_t alignment) noexcept
+{
+    releaseAligned(block, alignment);
+}
+
+void operator delete[](void* block, std::align_val_t alignment) noexcept
+{
+    releaseAligned(block, alignment);
+}
+
+void operator delete(void* block, size_t, std::align_val_t alignment) noexcept
+{
+    releaseAligned(block, alignment);
+}
+
+void operator delete[](void* block, size_t, std::align_val_t alignment) noexcept
+{
+    releaseAligned(block, alignment);
+}
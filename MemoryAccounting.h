@@ -0,0 +1,55 @@
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+#include <atomic>
+#include <cstddef>
+
+// Counts heap usage through the replaced global operator new/delete in
+// MemoryAccounting.cpp. Counting is off unless TREE_MEMORY_ACCOUNTING is set to
+// a non-zero value in the environment; the setting is read on the first
+// allocation and never changes, so every block is released the way it was
+// allocated. When off, an allocation costs one extra predictable branch.
+class MemoryAccounting
+{
+   private:
+    static std::atomic<size_t> liveBytes;
+    static std::atomic<size_t> peakBytes;
+    static std::atomic<size_t> liveBlocks;
+    static std::atomic<size_t> totalAllocations;
+
+   public:
+    static void recordAllocation(size_t bytes)
+    {
+        size_t live = liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        liveBlocks.fetch_add(1, std::memory_order_relaxed);
+        totalAllocations.fetch_add(1, std::memory_order_relaxed);
+
+        size_t peak = peakBytes.load(std::memory_order_relaxed);
+        while (live > peak &&
+               !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    static void recordRelease(size_t bytes)
+    {
+        liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+        liveBlocks.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    static bool isEnabled();
+
+    static size_t live() { return liveBytes.load(std::memory_order_relaxed); }
+
+    static size_t peak() { return peakBytes.load(std::memory_order_relaxed); }
+
+    static size_t blocks() { return liveBlocks.load(std::memory_order_relaxed); }
+
+    static size_t allocations() { return totalAllocations.load(std::memory_order_relaxed); }
+
+    static void resetPeak() { peakBytes.store(live(), std::memory_order_relaxed); }
+
+    static size_t footprint(size_t requested);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,463 @@
+#ifndef OPERATIONLOG_H
+#define OPERATIONLOG_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+enum class LogOperation : uint8_t
+{
+    Insert = 1,
+    Remove = 2
+};
+
+struct RecoveryReport
+{
+    bool checkpointFound = false;
+    bool counted = false;
+    uint64_t generation = 0;
+    size_t checkpointKeys = 0;
+    size_t replayedOperations = 0;
+    bool tornTail = false;
+};
+
+// Write-ahead log of RBTree mutations kept in a directory next to a checkpoint of
+// the sorted key set. Both files carry a generation number: a checkpoint of
+// generation g already contains everything logged in generation g - 1, so a crash
+// between writing the checkpoint and starting the new log never replays twice.
+//
+// append() blocks until its record is on disk. One writer thread syncs whatever
+// accumulated while the previous sync was running, so concurrent callers share
+// a single fsync (group commit).
+template <typename T>
+class OperationLog
+{
+    static_assert(std::is_trivially_copyable_v<T>, "OperationLog stores keys as raw bytes");
+
+   private:
+    static constexpr uint32_t checkpointMagic = 0x4b434252;  // "RBCK"
+    static constexpr uint32_t logMagic = 0x4c574252;         // "RBWL"
+    static constexpr uint32_t formatVersion = 1;
+    static constexpr size_t recordSize = 1 + sizeof(T);
+    static constexpr uint32_t maxBatchRecords = 1 << 24;
+
+    std::filesystem::path directory;
+    FILE* logFile;
+    uint64_t generation;
+    size_t checkpointEvery;
+    size_t sinceCheckpoint;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable synced;
+    std::vector<char> pending;
+    uint64_t appendedCount;
+    uint64_t syncedCount;
+    uint64_t commits;
+    bool stopping;
+    std::exception_ptr failure;
+    std::thread writer;
+
+    static uint64_t checksum(const char* data, size_t length)
+    {
+        uint64_t hash = 1469598103934665603ull;
+        for (size_t i = 0; i < length; i++)
+        {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    template <typename V>
+    static void putRaw(std::vector<char>& out, const V& value)
+    {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(V));
+    }
+
+    template <typename V>
+    static bool readRaw(FILE* file, V& value)
+    {
+        return std::fread(&value, sizeof(V), 1, file) == 1;
+    }
+
+    static void writeAll(FILE* file, const char* data, size_t length)
+    {
+        if (length > 0 && std::fwrite(data, 1, length, file) != length)
+        {
+            throw std::runtime_error("Write failed");
+        }
+    }
+
+    static void syncFile(FILE* file)
+    {
+        if (std::fflush(file) != 0)
+        {
+            throw std::runtime_error("Write failed");
+        }
+#if defined(__unix__) || defined(__APPLE__)
+        if (::fsync(fileno(file)) != 0)
+        {
+            throw std::runtime_error("fsync failed");
+        }
+#endif
+    }
+
+    static void syncDirectory(const std::filesystem::path& path)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd >= 0)
+        {
+            ::fsync(fd);
+            ::close(fd);
+        }
+#else
+        (void)path;
+#endif
+    }
+
+    std::filesystem::path checkpointPath() const { return directory / "checkpoint"; }
+
+    std::filesystem::path logPath() const { return directory / "wal"; }
+
+    FILE* openLog(uint64_t logGeneration)
+    {
+        std::filesystem::path temporary = directory / "wal.tmp";
+        FILE* file = std::fopen(temporary.c_str(), "wb");
+        if (!file)
+        {
+            throw std::runtime_error("Cannot create log: " + temporary.string());
+        }
+
+        std::vector<char> header;
+        putRaw(header, logMagic);
+        putRaw(header, formatVersion);
+        putRaw(header, logGeneration);
+        try
+        {
+            writeAll(file, header.data(), header.size());
+            syncFile(file);
+        }
+        catch (...)
+        {
+            std::fclose(file);
+            throw;
+        }
+
+        std::filesystem::rename(temporary, logPath());
+        syncDirectory(directory);
+        return file;
+    }
+
+    FILE* reopenLog()
+    {
+        FILE* file = std::fopen(logPath().c_str(), "ab");
+        if (!file)
+        {
+            throw std::runtime_error("Cannot open log: " + logPath().string());
+        }
+        return file;
+    }
+
+    void writerLoop()
+    {
+        std::vector<char> batch;
+        while (true)
+        {
+            uint64_t upTo;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !pending.empty(); });
+                if (pending.empty()) return;
+                size_t take = std::min(pending.size(), size_t(maxBatchRecords) * recordSize);
+                batch.assign(pending.begin(), pending.begin() + take);
+                pending.erase(pending.begin(), pending.begin() + take);
+                upTo = appendedCount - pending.size() / recordSize;
+            }
+
+            try
+            {
+                uint32_t records = static_cast<uint32_t>(batch.size() / recordSize);
+                uint64_t sum = checksum(batch.data(), batch.size());
+                std::vector<char> frame;
+                putRaw(frame, records);
+                writeAll(logFile, frame.data(), frame.size());
+                writeAll(logFile, batch.data(), batch.size());
+                frame.clear();
+                putRaw(frame, sum);
+                writeAll(logFile, frame.data(), frame.size());
+                syncFile(logFile);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                failure = std::current_exception();
+            }
+            batch.clear();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                syncedCount = upTo;
+                commits++;
+            }
+            synced.notify_all();
+        }
+    }
+
+    template <typename Tree>
+    static void replayLog(FILE* file, Tree& tree, RecoveryReport& report)
+    {
+        std::vector<char> batch;
+        while (true)
+        {
+            uint32_t records = 0;
+            size_t got = std::fread(&records, 1, sizeof(records), file);
+            if (got == 0) return;
+            if (got < sizeof(records) || records > maxBatchRecords)
+            {
+                report.tornTail = true;
+                return;
+            }
+
+            batch.resize(static_cast<size_t>(records) * recordSize);
+            uint64_t sum;
+            if (std::fread(batch.data(), 1, batch.size(), file) != batch.size() ||
+                !readRaw(file, sum) || sum != checksum(batch.data(), batch.size()))
+            {
+                report.tornTail = true;
+                return;
+            }
+
+            for (size_t offset = 0; offset < batch.size(); offset += recordSize)
+            {
+                T value;
+                std::memcpy(&value, batch.data() + offset + 1, sizeof(T));
+                if (static_cast<LogOperation>(batch[offset]) == LogOperation::Insert)
+                {
+                    tree.insert(value);
+                }
+                else
+                {
+                    tree.remove(value);
+                }
+            }
+            report.replayedOperations += records;
+        }
+    }
+
+   public:
+    OperationLog(const std::string& dir, size_t checkpointInterval = 100000)
+        : directory(dir),
+          logFile(nullptr),
+          generation(0),
+          checkpointEvery(checkpointInterval),
+          sinceCheckpoint(0),
+          appendedCount(0),
+          syncedCount(0),
+          commits(0),
+          stopping(false)
+    {
+        std::filesystem::create_directories(directory);
+    }
+
+    OperationLog(const OperationLog&) = delete;
+    OperationLog& operator=(const OperationLog&) = delete;
+
+    ~OperationLog()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        if (writer.joinable()) writer.join();
+        if (logFile) std::fclose(logFile);
+    }
+
+    bool hasState() const
+    {
+        return std::filesystem::exists(checkpointPath()) || std::filesystem::exists(logPath());
+    }
+
+    // Rebuilds tree from the checkpoint with buildFromSorted, replays the log tail on
+    // top of it and starts appending after the last complete batch. A batch cut
+    // short by a crash is dropped together with everything after it. With no
+    // saved state the given tree (or a new one) becomes the first checkpoint.
+    template <typename Tree>
+    RecoveryReport recover(std::unique_ptr<Tree>& tree, bool counted = false)
+    {
+        RecoveryReport report;
+        report.counted = counted;
+
+        if (FILE* file = std::fopen(checkpointPath().c_str(), "rb"))
+        {
+            uint32_t magic = 0;
+            uint32_t version = 0;
+            uint8_t countedFlag = 0;
+            uint64_t keys = 0;
+            uint64_t sum = 0;
+            std::vector<T> sorted;
+            bool valid = readRaw(file, magic) && magic == checkpointMagic &&
+                         readRaw(file, version) && version == formatVersion &&
+                         readRaw(file, generation) && readRaw(file, countedFlag) &&
+                         readRaw(file, keys);
+            if (valid)
+            {
+                sorted.resize(keys);
+                const char* bytes = reinterpret_cast<const char*>(sorted.data());
+                valid = std::fread(sorted.data(), sizeof(T), keys, file) == keys &&
+                        readRaw(file, sum) && sum == checksum(bytes, keys * sizeof(T));
+            }
+            std::fclose(file);
+            if (!valid)
+            {
+                throw std::runtime_error("Corrupt checkpoint: " + checkpointPath().string());
+            }
+
+            report.counted = countedFlag != 0;
+            tree = std::make_unique<Tree>(report.counted);
+            tree->buildFromSorted(sorted);
+            report.checkpointFound = true;
+            report.checkpointKeys = sorted.size();
+        }
+        else if (!tree)
+        {
+            tree = std::make_unique<Tree>(counted);
+        }
+        report.generation = generation;
+
+        bool logUsable = false;
+        if (FILE* file = std::fopen(logPath().c_str(), "rb"))
+        {
+            uint32_t magic = 0;
+            uint32_t version = 0;
+            uint64_t logGeneration = 0;
+            if (readRaw(file, magic) && magic == logMagic && readRaw(file, version) &&
+                version == formatVersion && readRaw(file, logGeneration) &&
+                logGeneration == generation)
+            {
+                replayLog(file, *tree, report);
+                logUsable = !report.tornTail;
+            }
+            std::fclose(file);
+        }
+
+        sinceCheckpoint = report.replayedOperations;
+        if (logUsable)
+        {
+            logFile = reopenLog();
+        }
+        else
+        {
+            checkpoint(*tree);
+        }
+
+        writer = std::thread(&OperationLog::writerLoop, this);
+        return report;
+    }
+
+    // Writes the sorted key set as generation + 1 and starts an empty log for it.
+    // The caller must not append concurrently.
+    template <typename Tree>
+    void checkpoint(Tree& tree)
+    {
+        std::vector<T> sorted;
+        sorted.reserve(tree.totalCount());
+        tree.inorderTraversal([&sorted](T value) { sorted.push_back(value); });
+
+        uint64_t next = generation + 1;
+        std::filesystem::path temporary = directory / "checkpoint.tmp";
+        FILE* file = std::fopen(temporary.c_str(), "wb");
+        if (!file)
+        {
+            throw std::runtime_error("Cannot create checkpoint: " + temporary.string());
+        }
+
+        try
+        {
+            std::vector<char> header;
+            putRaw(header, checkpointMagic);
+            putRaw(header, formatVersion);
+            putRaw(header, next);
+            putRaw(header, static_cast<uint8_t>(tree.isCounted() ? 1 : 0));
+            putRaw(header, static_cast<uint64_t>(sorted.size()));
+            writeAll(file, header.data(), header.size());
+
+            const char* bytes = reinterpret_cast<const char*>(sorted.data());
+            writeAll(file, bytes, sorted.size() * sizeof(T));
+
+            header.clear();
+            putRaw(header, checksum(bytes, sorted.size() * sizeof(T)));
+            writeAll(file, header.data(), header.size());
+            syncFile(file);
+        }
+        catch (...)
+        {
+            std::fclose(file);
+            throw;
+        }
+        std::fclose(file);
+
+        std::filesystem::rename(temporary, checkpointPath());
+        syncDirectory(directory);
+
+        FILE* nextLog = openLog(next);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (logFile) std::fclose(logFile);
+        logFile = nextLog;
+        generation = next;
+        sinceCheckpoint = 0;
+    }
+
+    void append(LogOperation operation, const T& value)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (failure) std::rethrow_exception(failure);
+
+        pending.push_back(static_cast<char>(operation));
+        putRaw(pending, value);
+        uint64_t ticket = ++appendedCount;
+        sinceCheckpoint++;
+        wake.notify_one();
+
+        synced.wait(lock, [this, ticket]() { return syncedCount >= ticket; });
+        if (failure) std::rethrow_exception(failure);
+    }
+
+    bool needsCheckpoint() const
+    {
+        return checkpointEvery > 0 && sinceCheckpoint >= checkpointEvery;
+    }
+
+    uint64_t currentGeneration() const { return generation; }
+
+    size_t operationsSinceCheckpoint() const { return sinceCheckpoint; }
+
+    uint64_t commitCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return commits;
+    }
+
+    std::string getDirectory() const { return directory.string(); }
+};
+
+#endif
@@ -1,59 +1,315 @@
 #ifndef PARSER_H
 #define PARSER_H
 
-#include <cctype>
+#include <functional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "BinaryTree.h"
 
+// Receives the keys of a parsed tree in preorder, without the tree itself.
 template <typename T>
-class Parser
+class ParserSink
+{
+   public:
+    virtual ~ParserSink() = default;
+
+    virtual void add(const T& value) = 0;
+};
+
+// The tree format as a push parser. Text may arrive in pieces of any size, and
+// handler.open(key, offset) and handler.close() run for every '(' and ')' as soon
+// as they are read, so keys come out in preorder; offset is where the '(' stands in
+// the whole text. Problems are recorded instead of thrown, and finish() reports the
+// one a validating recursive descent would: an invalid character, unbalanced
+// parentheses, the first structural error, then an empty or unfinished tree.
+// Everything is constexpr, so tree literals are parsed by the same code at compile
+// time.
+template <typename T>
+class TreeScanner
 {
    private:
-    std::string input;
-    size_t pos;
+    enum class State
+    {
+        ExpectOpen,
+        ExpectNumber,
+        AfterMinus,
+        InNumber,
+        InChildren,
+        Done
+    };
+
+    std::vector<int> childCounts;
+    State state = State::ExpectOpen;
+    T number = 0;
+    bool negative = false;
+    bool sawNode = false;
+    size_t consumed = 0;
+    size_t nodeOffset = 0;
+    const char* structureError = nullptr;
+    bool invalidChar = false;
+    bool unbalanced = false;
+    long long balance = 0;
 
-    void skipWhitespace()
+   public:
+    // Character classes of the C locale, usable in constant expressions.
+    static constexpr bool isSpace(char c)
     {
-        while (pos < input.length() && std::isspace(input[pos]))
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    static constexpr bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+    static constexpr bool isAllowed(char c)
+    {
+        return isSpace(c) || isDigit(c) || c == '(' || c == ')' || c == '-';
+    }
+
+    constexpr TreeScanner() = default;
+
+    // True once an invalid character was seen; the rest of the input is ignored.
+    constexpr bool failed() const { return invalidChar; }
+
+    template <typename Handler>
+    constexpr void feed(std::string_view text, Handler& handler)
+    {
+        for (size_t i = 0; i < text.length() && !invalidChar; i++)
         {
-            pos++;
+            char c = text[i];
+            bool space = isSpace(c);
+            bool digit = isDigit(c);
+
+            if (!isAllowed(c))
+            {
+                invalidChar = true;
+                break;
+            }
+            if (c == '(') balance++;
+            if (c == ')') balance--;
+            if (balance < 0) unbalanced = true;
+
+            if (structureError) continue;
+
+            if (state == State::InNumber)
+            {
+                if (digit)
+                {
+                    number = number * 10 + (c - '0');
+                    continue;
+                }
+                handler.open(negative ? -number : number, nodeOffset);
+                childCounts.push_back(0);
+                state = State::InChildren;
+            }
+
+            switch (state)
+            {
+                case State::ExpectOpen:
+                    if (space) break;
+                    if (c != '(')
+                    {
+                        structureError = "Expected '('";
+                        break;
+                    }
+                    sawNode = true;
+                    nodeOffset = consumed + i;
+                    state = State::ExpectNumber;
+                    break;
+
+                case State::ExpectNumber:
+                    if (space) break;
+                    negative = c == '-';
+                    number = 0;
+                    if (negative)
+                    {
+                        state = State::AfterMinus;
+                    }
+                    else if (digit)
+                    {
+                        number = c - '0';
+                        state = State::InNumber;
+                    }
+                    else
+                    {
+                        structureError = "Expected number";
+                    }
+                    break;
+
+                case State::AfterMinus:
+                    if (digit)
+                    {
+                        number = c - '0';
+                        state = State::InNumber;
+                    }
+                    else
+                    {
+                        structureError = "Expected number";
+                    }
+                    break;
+
+                case State::InChildren:
+                    if (space) break;
+                    if (c == ')')
+                    {
+                        childCounts.pop_back();
+                        handler.close();
+                        if (childCounts.empty()) state = State::Done;
+                    }
+                    else if (c == '(')
+                    {
+                        if (++childCounts.back() > 2)
+                        {
+                            structureError = "More than two children (not a binary tree)";
+                            break;
+                        }
+                        nodeOffset = consumed + i;
+                        state = State::ExpectNumber;
+                    }
+                    else
+                    {
+                        structureError = "Expected '(' or ')'";
+                    }
+                    break;
+
+                case State::Done:
+                    if (!space) structureError = "Extra characters after tree";
+                    break;
+
+                case State::InNumber:
+                    break;
+            }
         }
+        consumed += text.length();
     }
 
-    T parseNumber()
+    // Throws unless everything fed so far is exactly one well-formed tree.
+    constexpr void finish() const
     {
-        skipWhitespace();
-
-        if (pos >= input.length())
+        if (invalidChar)
+        {
+            throw std::runtime_error("Invalid character in input");
+        }
+        if (unbalanced || balance != 0)
+        {
+            throw std::runtime_error("Unbalanced parentheses");
+        }
+        if (structureError)
+        {
+            throw std::runtime_error(structureError);
+        }
+        if (!sawNode)
+        {
+            throw std::runtime_error("Empty input");
+        }
+        if (state != State::Done)
         {
             throw std::runtime_error("Unexpected end of input");
         }
+    }
+};
 
-        bool negative = false;
-        if (input[pos] == '-')
+// TreeScanner handler that links the nodes into a binary tree, through interner
+// when there is one. Nodes of a tree left unfinished by an error are freed.
+template <typename T>
+class BinaryTreeAssembler
+{
+   private:
+    struct Frame
+    {
+        T value;
+        BinaryTreeNode<T>* left;
+        BinaryTreeNode<T>* right;
+    };
+
+    NodeInterner<T>* interner;
+    std::vector<Frame> pending;
+    BinaryTreeNode<T>* root;
+
+    void destroy(BinaryTreeNode<T>* node)
+    {
+        if (!interner) BinaryTree<T>::destroySubtree(node);
+    }
+
+   public:
+    BinaryTreeAssembler(NodeInterner<T>* nodeInterner = nullptr)
+        : interner(nodeInterner), root(nullptr)
+    {
+    }
+
+    BinaryTreeAssembler(const BinaryTreeAssembler&) = delete;
+    BinaryTreeAssembler& operator=(const BinaryTreeAssembler&) = delete;
+
+    ~BinaryTreeAssembler()
+    {
+        for (const Frame& frame : pending)
         {
-            negative = true;
-            pos++;
+            destroy(frame.left);
+            destroy(frame.right);
         }
+        destroy(root);
+    }
 
-        if (pos >= input.length() || !std::isdigit(input[pos]))
+    void open(const T& value, size_t) { pending.push_back({value, nullptr, nullptr}); }
+
+    // Children are never null, so the first one to close is the left one.
+    void close()
+    {
+        Frame& frame = pending.back();
+        BinaryTreeNode<T>* node;
+        if (interner)
         {
-            throw std::runtime_error("Expected number");
+            node = interner->intern(frame.value, frame.left, frame.right);
         }
+        else
+        {
+            node = new BinaryTreeNode<T>(frame.value);
+            node->left = frame.left;
+            node->right = frame.right;
+        }
+        pending.pop_back();
 
-        T value = 0;
-        while (pos < input.length() && std::isdigit(input[pos]))
+        if (pending.empty())
         {
-            value = value * 10 + (input[pos] - '0');
-            pos++;
+            root = node;
+        }
+        else
+        {
+            Frame& parent = pending.back();
+            (parent.left ? parent.right : parent.left) = node;
         }
+    }
 
-        return negative ? -value : value;
+    // The finished tree; the caller owns it from now on.
+    BinaryTreeNode<T>* release()
+    {
+        BinaryTreeNode<T>* result = root;
+        root = nullptr;
+        return result;
     }
+};
 
-    BinaryTreeNode<T>* parseNode()
+template <typename T>
+class Parser
+{
+   protected:
+    std::string input;
+    size_t pos;
+    NodeInterner<T>* interner;
+
+    // Pull-style helpers over the same tokens, for formats built on top of Parser
+    // such as IntervalParser. Trees themselves go through TreeScanner.
+    constexpr void skipWhitespace()
+    {
+        while (pos < input.length() && TreeScanner<T>::isSpace(input[pos]))
+        {
+            pos++;
+        }
+    }
+
+    constexpr T parseNumber()
     {
         skipWhitespace();
 
@@ -62,64 +318,33 @@ class Parser
             throw std::runtime_error("Unexpected end of input");
         }
 
-        if (input[pos] != '(')
+        bool negative = false;
+        if (input[pos] == '-')
         {
-            throw std::runtime_error("Expected '('");
+            negative = true;
+            pos++;
         }
-        pos++;
-
-        T value = parseNumber();
-        BinaryTreeNode<T>* node = new BinaryTreeNode<T>(value);
 
-        int childCount = 0;
-
-        while (true)
+        if (pos >= input.length() || !TreeScanner<T>::isDigit(input[pos]))
         {
-            skipWhitespace();
-
-            if (pos >= input.length())
-            {
-                throw std::runtime_error("Unexpected end of input");
-            }
-
-            if (input[pos] == ')')
-            {
-                pos++;
-                break;
-            }
-
-            if (input[pos] == '(')
-            {
-                childCount++;
-
-                if (childCount > 2)
-                {
-                    throw std::runtime_error("More than two children (not a binary tree)");
-                }
+            throw std::runtime_error("Expected number");
+        }
 
-                if (childCount == 1)
-                {
-                    node->left = parseNode();
-                }
-                else
-                {
-                    node->right = parseNode();
-                }
-            }
-            else
-            {
-                throw std::runtime_error("Expected '(' or ')'");
-            }
+        T value = 0;
+        while (pos < input.length() && TreeScanner<T>::isDigit(input[pos]))
+        {
+            value = value * 10 + (input[pos] - '0');
+            pos++;
         }
 
-        return node;
+        return negative ? -value : value;
     }
 
-    void validateInput()
+    constexpr void validateInput() const
     {
         for (char c : input)
         {
-            if (!std::isspace(c) && !std::isdigit(c) && c != '(' && c != ')' && c != '-')
+            if (!TreeScanner<T>::isAllowed(c))
             {
                 throw std::runtime_error("Invalid character in input");
             }
@@ -144,30 +369,192 @@ class Parser
     }
 
    public:
-    Parser(const std::string& str) : input(str), pos(0) {}
+    Parser(const std::string& str, NodeInterner<T>* nodeInterner = nullptr)
+        : input(str), pos(0), interner(nodeInterner)
+    {
+    }
 
-    BinaryTreeNode<T>* parse()
+    // With a sink, every key is also handed to it in preorder as the tree is built.
+    BinaryTreeNode<T>* parse(ParserSink<T>* sink = nullptr)
     {
-        validateInput();
+        struct Forward
+        {
+            BinaryTreeAssembler<T>& assembler;
+            ParserSink<T>* sink;
 
-        skipWhitespace();
+            void open(const T& value, size_t offset)
+            {
+                assembler.open(value, offset);
+                if (sink) sink->add(value);
+            }
+
+            void close() { assembler.close(); }
+        };
+
+        BinaryTreeAssembler<T> assembler(interner);
+        Forward forward{assembler, sink};
+        TreeScanner<T> scanner;
+        scanner.feed(input, forward);
+        scanner.finish();
+        return assembler.release();
+    }
 
-        if (input.empty() || pos >= input.length())
+    // Reports the same errors as parse(), but hands each key to sink instead of
+    // allocating nodes. Keys read before an error is found have already reached
+    // sink by the time it is thrown.
+    void parseInto(ParserSink<T>& sink)
+    {
+        struct Forward
         {
-            throw std::runtime_error("Empty input");
+            ParserSink<T>& sink;
+
+            void open(const T& value, size_t) { sink.add(value); }
+
+            void close() {}
+        };
+
+        Forward forward{sink};
+        TreeScanner<T> scanner;
+        scanner.feed(input, forward);
+        scanner.finish();
+    }
+};
+
+template <typename T>
+class LazyTreeSource : public LazyNodeSource<T>
+{
+   private:
+    std::string input;
+    std::vector<size_t> offsets;
+    std::vector<size_t> ends;
+
+    // Records where every node starts and the id just past its subtree; the keys
+    // are read again from the text when a node is materialized.
+    struct Indexer
+    {
+        std::vector<size_t>& offsets;
+        std::vector<size_t>& ends;
+        std::vector<size_t> unclosed;
+
+        void open(const T&, size_t offset)
+        {
+            unclosed.push_back(offsets.size());
+            offsets.push_back(offset);
+            ends.push_back(0);
         }
 
-        BinaryTreeNode<T>* root = parseNode();
+        void close()
+        {
+            ends[unclosed.back()] = offsets.size();
+            unclosed.pop_back();
+        }
+    };
 
-        skipWhitespace();
+    void scan()
+    {
+        Indexer indexer{offsets, ends, {}};
+        TreeScanner<T> scanner;
+        scanner.feed(input, indexer);
+        scanner.finish();
+    }
+
+   public:
+    LazyTreeSource(std::string text) : input(std::move(text)) { scan(); }
+
+    size_t nodeCount() const override { return offsets.size(); }
+
+    T value(size_t id) const override
+    {
+        size_t pos = offsets[id] + 1;
+        while (TreeScanner<T>::isSpace(input[pos])) pos++;
+
+        bool negative = input[pos] == '-';
+        if (negative) pos++;
+
+        T result = 0;
+        while (pos < input.length() && TreeScanner<T>::isDigit(input[pos]))
+        {
+            result = result * 10 + (input[pos] - '0');
+            pos++;
+        }
+        return negative ? -result : result;
+    }
+
+    size_t children(size_t id, size_t childIds[2]) const override
+    {
+        size_t count = 0;
+        size_t child = id + 1;
+        while (child < ends[id])
+        {
+            childIds[count++] = child;
+            child = ends[child];
+        }
+        return count;
+    }
+
+    size_t memoryBytes() const override
+    {
+        return input.capacity() + (offsets.capacity() + ends.capacity()) * sizeof(size_t);
+    }
 
-        if (pos < input.length())
+    void forEachValue(std::function<void(T)> visit) const override
+    {
+        for (size_t id = 0; id < offsets.size(); id++)
         {
-            throw std::runtime_error("Extra characters after tree");
+            visit(value(id));
         }
+    }
+};
 
-        return root;
+// Parses a tree that arrives in chunks: feed() hands every key to emit as soon as
+// it is read. With keepTree false only the keys are emitted and finish() returns
+// nullptr; the input is validated the same way either way.
+template <typename T>
+class StreamingParser
+{
+   private:
+    template <typename Emit>
+    struct Forward
+    {
+        Emit& emit;
+        BinaryTreeAssembler<T>* assembler;
+
+        void open(const T& value, size_t offset)
+        {
+            if (assembler) assembler->open(value, offset);
+            emit(value);
+        }
+
+        void close()
+        {
+            if (assembler) assembler->close();
+        }
+    };
+
+    TreeScanner<T> scanner;
+    BinaryTreeAssembler<T> assembler;
+    bool buildTree;
+
+   public:
+    StreamingParser(NodeInterner<T>* nodeInterner = nullptr, bool keepTree = true)
+        : assembler(nodeInterner), buildTree(keepTree)
+    {
+    }
+
+    bool failed() const { return scanner.failed(); }
+
+    template <typename Emit>
+    void feed(const char* data, size_t length, Emit emit)
+    {
+        Forward<Emit> forward{emit, buildTree ? &assembler : nullptr};
+        scanner.feed(std::string_view(data, length), forward);
+    }
+
+    BinaryTreeNode<T>* finish()
+    {
+        scanner.finish();
+        return assembler.release();
     }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -1,9 +1,21 @@
 #ifndef RBTREE_H
 #define RBTREE_H
 
+#include <algorithm>
+#include <compare>
+#include <concepts>
+#include <cstddef>
 #include <functional>
+#include <iterator>
+#include <memory>
 #include <queue>
 #include <stack>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "LookupCache.h"
+#include "MembershipFilter.h"
 
 enum Color
 {
@@ -12,6 +24,69 @@ enum Color
 };
 
 template <typename T>
+struct NoAggregate
+{
+    struct value_type
+    {
+    };
+
+    static value_type identity() { return {}; }
+
+    static value_type lift(const T&, size_t) { return {}; }
+
+    static value_type combine(const value_type&, const value_type&) { return {}; }
+};
+
+template <typename T>
+struct RangeSummary
+{
+    using Sum = std::conditional_t<std::is_integral_v<T>, long long, T>;
+
+    struct value_type
+    {
+        size_t count;
+        Sum sum;
+        T min;
+        T max;
+    };
+
+    static value_type identity() { return {0, Sum(), T(), T()}; }
+
+    static value_type lift(const T& key, size_t count)
+    {
+        return {count, static_cast<Sum>(key) * static_cast<Sum>(count), key, key};
+    }
+
+    static value_type combine(const value_type& a, const value_type& b)
+    {
+        if (a.count == 0) return b;
+        if (b.count == 0) return a;
+        return {a.count + b.count, a.sum + b.sum, b.min < a.min ? b.min : a.min,
+                a.max < b.max ? b.max : a.max};
+    }
+};
+
+// Default ordering: a single operator<=> call where the key type has one, otherwise
+// an ordering derived from operator<.
+struct ThreeWayCompare
+{
+    template <typename A, typename B>
+    constexpr auto operator()(const A& a, const B& b) const
+    {
+        if constexpr (std::three_way_comparable_with<A, B>)
+        {
+            return a <=> b;
+        }
+        else
+        {
+            return a < b   ? std::weak_ordering::less
+                   : b < a ? std::weak_ordering::greater
+                           : std::weak_ordering::equivalent;
+        }
+    }
+};
+
+template <typename T, typename Aggregate = NoAggregate<T>>
 struct RBNode
 {
     T data;
@@ -19,19 +94,104 @@ struct RBNode
     RBNode* right;
     RBNode* parent;
     Color color;
-
-    RBNode(T val) : data(val), left(nullptr), right(nullptr), parent(nullptr), color(RED) {}
+    size_t count;
+    size_t weight;
+    [[no_unique_address]] typename Aggregate::value_type aggregate;
+
+    RBNode(T val)
+        : data(val),
+          left(nullptr),
+          right(nullptr),
+          parent(nullptr),
+          color(RED),
+          count(1),
+          weight(1),
+          aggregate(Aggregate::lift(val, 1))
+    {
+    }
 };
 
-template <typename T>
+// Compare is called as compare(a, b) and returns anything that can be tested
+// against 0 like the result of operator<=>. Every step down the tree makes
+// exactly one call.
+template <typename T, typename Aggregate = NoAggregate<T>, typename Compare = ThreeWayCompare>
 class RBTree
 {
+   public:
+    using Node = RBNode<T, Aggregate>;
+    using AggregateValue = typename Aggregate::value_type;
+
    private:
-    RBNode<T>* root;
+    Node* root;
+    Node* leftmost;
+    Node* rightmost;
+    Node* finger;
+    size_t nodeCount;
+    bool counted;
+    bool fingerInsertion;
+    bool bulkLoading;
+    [[no_unique_address]] Compare compare;
+    std::unique_ptr<LookupCache<T, Node*>> cache;
+    std::unique_ptr<CountingBloomFilter<T>> filter;
+
+    static constexpr bool hashable = requires(const T& value) { std::hash<T>{}(value); };
+
+    // Keys that a custom Compare calls equal may hash apart, so structures keyed
+    // by std::hash<T> are only offered with the default ordering.
+    static constexpr bool hashMatchesCompare = hashable && std::same_as<Compare, ThreeWayCompare>;
+
+    bool less(const T& a, const T& b) const { return compare(a, b) < 0; }
+
+    static size_t weightOf(Node* node) { return node ? node->weight : 0; }
 
-    void rotateLeft(RBNode<T>* node)
+    static AggregateValue aggregateOf(Node* node)
     {
-        RBNode<T>* rightChild = node->right;
+        return node ? node->aggregate : Aggregate::identity();
+    }
+
+    static AggregateValue liftNode(Node* node) { return Aggregate::lift(node->data, node->count); }
+
+    static void updateNode(Node* node)
+    {
+        node->weight = weightOf(node->left) + weightOf(node->right) + node->count;
+        node->aggregate = Aggregate::combine(
+            aggregateOf(node->left),
+            Aggregate::combine(liftNode(node), aggregateOf(node->right)));
+    }
+
+    void updatePathToRoot(Node* node) const
+    {
+        if (bulkLoading) return;
+        for (; node != nullptr; node = node->parent) updateNode(node);
+    }
+
+    static Node* successor(Node* node)
+    {
+        if (node->right != nullptr)
+        {
+            node = node->right;
+            while (node->left != nullptr) node = node->left;
+            return node;
+        }
+        while (node->parent != nullptr && node == node->parent->right) node = node->parent;
+        return node->parent;
+    }
+
+    static Node* predecessor(Node* node)
+    {
+        if (node->left != nullptr)
+        {
+            node = node->left;
+            while (node->right != nullptr) node = node->right;
+            return node;
+        }
+        while (node->parent != nullptr && node == node->parent->left) node = node->parent;
+        return node->parent;
+    }
+
+    void rotateLeft(Node* node)
+    {
+        Node* rightChild = node->right;
         node->right = rightChild->left;
 
         if (rightChild->left != nullptr)
@@ -56,11 +216,14 @@ class RBTree
 
         rightChild->left = node;
         node->parent = rightChild;
+
+        updateNode(node);
+        updateNode(rightChild);
     }
 
-    void rotateRight(RBNode<T>* node)
+    void rotateRight(Node* node)
     {
-        RBNode<T>* leftChild = node->left;
+        Node* leftChild = node->left;
         node->left = leftChild->right;
 
         if (leftChild->right != nullptr)
@@ -85,15 +248,18 @@ class RBTree
 
         leftChild->right = node;
         node->parent = leftChild;
+
+        updateNode(node);
+        updateNode(leftChild);
     }
 
-    void fixInsert(RBNode<T>* node)
+    void fixInsert(Node* node)
     {
         while (node != root && node->parent->color == RED)
         {
             if (node->parent == node->parent->parent->left)
             {
-                RBNode<T>* uncle = node->parent->parent->right;
+                Node* uncle = node->parent->parent->right;
 
                 if (uncle != nullptr && uncle->color == RED)
                 {
@@ -116,7 +282,7 @@ class RBTree
             }
             else
             {
-                RBNode<T>* uncle = node->parent->parent->left;
+                Node* uncle = node->parent->parent->left;
 
                 if (uncle != nullptr && uncle->color == RED)
                 {
@@ -141,49 +307,120 @@ class RBTree
         root->color = BLACK;
     }
 
-    void insertNode(T value)
+    Node* addDuplicate(Node* node)
     {
-        RBNode<T>* newNode = new RBNode<T>(value);
-        RBNode<T>* parent = nullptr;
-        RBNode<T>* current = root;
+        if (counted)
+        {
+            node->count++;
+            updatePathToRoot(node);
+        }
+        return node;
+    }
 
-        while (current != nullptr)
+    Node* attachNode(Node* parent, bool asLeft, const T& value)
+    {
+        if constexpr (hashable)
         {
-            parent = current;
-            if (newNode->data < current->data)
-            {
-                current = current->left;
-            }
-            else if (newNode->data > current->data)
-            {
-                current = current->right;
-            }
-            else
+            if (cache) cache->invalidate(value);
+            if (filter)
             {
-                delete newNode;
-                return;
+                if (filter->isFull()) rebuildFilter(2 * (nodeCount + 1), filter->getTargetRate());
+                filter->insert(value);
             }
         }
 
+        Node* newNode = new Node(value);
         newNode->parent = parent;
+        nodeCount++;
 
         if (parent == nullptr)
         {
             root = newNode;
+            leftmost = newNode;
+            rightmost = newNode;
         }
-        else if (newNode->data < parent->data)
+        else if (asLeft)
         {
             parent->left = newNode;
+            if (parent == leftmost) leftmost = newNode;
         }
         else
         {
             parent->right = newNode;
+            if (parent == rightmost) rightmost = newNode;
         }
 
+        updatePathToRoot(parent);
         fixInsert(newNode);
+        return newNode;
     }
 
-    void transplant(RBNode<T>* u, RBNode<T>* v)
+    // Descends from start, whose subtree must contain the insertion point.
+    Node* insertBelow(Node* start, const T& value)
+    {
+        Node* parent = start ? start->parent : nullptr;
+        Node* current = start;
+        bool goLeft = false;
+
+        while (current != nullptr)
+        {
+            auto order = compare(value, current->data);
+            if (order == 0)
+            {
+                return addDuplicate(current);
+            }
+            parent = current;
+            goLeft = order < 0;
+            current = goLeft ? current->left : current->right;
+        }
+
+        return attachNode(parent, goLeft, value);
+    }
+
+    // Finger search from the last insertion point: appends past either end attach
+    // directly, otherwise climb through parent pointers to the lowest ancestor
+    // whose subtree must hold value and descend from there. The climb compares
+    // only at ancestors that could bound value, so nearby keys cost O(log d) for a
+    // distance d instead of O(log n).
+    Node* insertFromFinger(const T& value)
+    {
+        if (finger == nullptr) return insertBelow(root, value);
+
+        if (compare(rightmost->data, value) < 0) return attachNode(rightmost, false, value);
+        if (compare(value, leftmost->data) < 0) return attachNode(leftmost, true, value);
+
+        auto order = compare(value, finger->data);
+        if (order == 0) return addDuplicate(finger);
+
+        bool ascending = order > 0;
+        Node* current = finger;
+        while (current->parent != nullptr)
+        {
+            Node* parent = current->parent;
+            if ((current == parent->left) == ascending)
+            {
+                auto bound = compare(value, parent->data);
+                if (bound == 0) return addDuplicate(parent);
+                if ((bound < 0) == ascending) break;
+            }
+            current = parent;
+        }
+        return insertBelow(current, value);
+    }
+
+    void insertNode(const T& value)
+    {
+        if (fingerInsertion)
+        {
+            finger = insertFromFinger(value);
+        }
+        else
+        {
+            insertBelow(root, value);
+        }
+    }
+
+    void transplant(Node* u, Node* v)
     {
         if (u->parent == nullptr)
         {
@@ -203,7 +440,7 @@ class RBTree
         }
     }
 
-    RBNode<T>* minimum(RBNode<T>* node)
+    Node* minimum(Node* node)
     {
         while (node->left != nullptr)
         {
@@ -212,27 +449,28 @@ class RBTree
         return node;
     }
 
-    void fixDelete(RBNode<T>* node)
+    void fixDelete(Node* node, Node* parent)
     {
         while (node != root && (node == nullptr || node->color == BLACK))
         {
-            if (node == node->parent->left)
+            if (node == parent->left)
             {
-                RBNode<T>* sibling = node->parent->right;
+                Node* sibling = parent->right;
 
                 if (sibling != nullptr && sibling->color == RED)
                 {
                     sibling->color = BLACK;
-                    node->parent->color = RED;
-                    rotateLeft(node->parent);
-                    sibling = node->parent->right;
+                    parent->color = RED;
+                    rotateLeft(parent);
+                    sibling = parent->right;
                 }
 
                 if ((sibling->left == nullptr || sibling->left->color == BLACK) &&
                     (sibling->right == nullptr || sibling->right->color == BLACK))
                 {
                     sibling->color = RED;
-                    node = node->parent;
+                    node = parent;
+                    parent = node->parent;
                 }
                 else
                 {
@@ -244,35 +482,36 @@ class RBTree
                         }
                         sibling->color = RED;
                         rotateRight(sibling);
-                        sibling = node->parent->right;
+                        sibling = parent->right;
                     }
-                    sibling->color = node->parent->color;
-                    node->parent->color = BLACK;
+                    sibling->color = parent->color;
+                    parent->color = BLACK;
                     if (sibling->right != nullptr)
                     {
                         sibling->right->color = BLACK;
                     }
-                    rotateLeft(node->parent);
+                    rotateLeft(parent);
                     node = root;
                 }
             }
             else
             {
-                RBNode<T>* sibling = node->parent->left;
+                Node* sibling = parent->left;
 
                 if (sibling != nullptr && sibling->color == RED)
                 {
                     sibling->color = BLACK;
-                    node->parent->color = RED;
-                    rotateRight(node->parent);
-                    sibling = node->parent->left;
+                    parent->color = RED;
+                    rotateRight(parent);
+                    sibling = parent->left;
                 }
 
                 if ((sibling->right == nullptr || sibling->right->color == BLACK) &&
                     (sibling->left == nullptr || sibling->left->color == BLACK))
                 {
                     sibling->color = RED;
-                    node = node->parent;
+                    node = parent;
+                    parent = node->parent;
                 }
                 else
                 {
@@ -284,15 +523,15 @@ class RBTree
                         }
                         sibling->color = RED;
                         rotateLeft(sibling);
-                        sibling = node->parent->left;
+                        sibling = parent->left;
                     }
-                    sibling->color = node->parent->color;
-                    node->parent->color = BLACK;
+                    sibling->color = parent->color;
+                    parent->color = BLACK;
                     if (sibling->left != nullptr)
                     {
                         sibling->left->color = BLACK;
                     }
-                    rotateRight(node->parent);
+                    rotateRight(parent);
                     node = root;
                 }
             }
@@ -303,10 +542,20 @@ class RBTree
         }
     }
 
-    void deleteNode(RBNode<T>* node)
+    void deleteNode(Node* node)
     {
-        RBNode<T>* y = node;
-        RBNode<T>* x;
+        if (node == leftmost) leftmost = successor(node);
+        if (node == rightmost) rightmost = predecessor(node);
+        if (node == finger) finger = nullptr;
+        if constexpr (hashable)
+        {
+            if (cache) cache->invalidate(node->data);
+            if (filter) filter->remove(node->data);
+        }
+
+        Node* y = node;
+        Node* x;
+        Node* xParent = node->parent;
         Color yOriginalColor = y->color;
 
         if (node->left == nullptr)
@@ -327,6 +576,7 @@ class RBTree
 
             if (y->parent == node)
             {
+                xParent = y;
                 if (x != nullptr)
                 {
                     x->parent = y;
@@ -334,6 +584,7 @@ class RBTree
             }
             else
             {
+                xParent = y->parent;
                 transplant(y, y->right);
                 y->right = node->right;
                 y->right->parent = y;
@@ -346,71 +597,553 @@ class RBTree
         }
 
         delete node;
+        nodeCount--;
+        updatePathToRoot(xParent);
+
+        if (yOriginalColor == BLACK)
+        {
+            fixDelete(x, xParent);
+        }
+    }
 
-        if (yOriginalColor == BLACK && x != nullptr)
+    Node* searchNode(Node* node, const T& value) const
+    {
+        while (node != nullptr)
         {
-            fixDelete(x);
+            auto order = compare(value, node->data);
+            if (order == 0)
+            {
+                return node;
+            }
+            node = order < 0 ? node->left : node->right;
         }
+        return nullptr;
     }
 
-    RBNode<T>* searchNode(RBNode<T>* node, T value)
+    // Node holding value or nullptr. The membership filter turns most absent keys
+    // away first; the lookup cache then answers repeated keys without a descent.
+    Node* findNode(const T& value) const
     {
-        if (node == nullptr || node->data == value)
+        if constexpr (hashable)
         {
+            if (filter && !filter->mayContain(value)) return nullptr;
+
+            Node* node;
+            if (cache)
+            {
+                auto equal = [this](const T& a, const T& b) { return compare(a, b) == 0; };
+                if (!cache->find(value, node, equal))
+                {
+                    node = searchNode(root, value);
+                    cache->store(value, node);
+                }
+            }
+            else
+            {
+                node = searchNode(root, value);
+            }
+
+            if (filter && node == nullptr) filter->recordFalsePositive();
             return node;
         }
+        return searchNode(root, value);
+    }
 
-        if (value < node->data)
+    // Replaces the filter with one sized for capacity keys and refills it from
+    // the tree in order. Lookup statistics start over.
+    void rebuildFilter(size_t capacity, double falsePositiveRate)
+    {
+        filter = std::make_unique<CountingBloomFilter<T>>(capacity, falsePositiveRate);
+        for (Node* node = leftmost; node != nullptr; node = successor(node))
         {
-            return searchNode(node->left, value);
+            filter->insert(node->data);
         }
-        else
+    }
+
+    // Recomputes weights and aggregates below top in postorder, following parent
+    // pointers instead of keeping a stack.
+    static void updateSubtree(Node* top)
+    {
+        if (top == nullptr) return;
+
+        auto deepestFirst = [](Node* node)
+        {
+            while (node->left || node->right) node = node->left ? node->left : node->right;
+            return node;
+        };
+
+        Node* node = deepestFirst(top);
+        while (true)
+        {
+            updateNode(node);
+            if (node == top) return;
+
+            Node* parent = node->parent;
+            node = node == parent->left && parent->right ? deepestFirst(parent->right) : parent;
+        }
+    }
+
+    // Splits keys into halves top-down with a stack of pending ranges, which never
+    // holds more than one range per level. Nodes at depth redDepth are red.
+    Node* buildBalanced(const std::vector<T>& keys, const std::vector<size_t>& counts,
+                        size_t redDepth)
+    {
+        struct Range
         {
-            return searchNode(node->right, value);
+            size_t lo;
+            size_t hi;
+            size_t depth;
+            Node* parent;
+            bool asLeft;
+        };
+
+        Node* top = nullptr;
+        std::vector<Range> pending;
+        if (!keys.empty()) pending.push_back({0, keys.size(), 0, nullptr, true});
+        while (!pending.empty())
+        {
+            Range range = pending.back();
+            pending.pop_back();
+
+            size_t mid = range.lo + (range.hi - range.lo) / 2;
+            Node* node = new Node(keys[mid]);
+            node->count = counts[mid];
+            node->color = range.depth == redDepth ? RED : BLACK;
+            node->parent = range.parent;
+            if (range.parent == nullptr)
+            {
+                top = node;
+            }
+            else
+            {
+                (range.asLeft ? range.parent->left : range.parent->right) = node;
+            }
+
+            if (mid + 1 < range.hi)
+            {
+                pending.push_back({mid + 1, range.hi, range.depth + 1, node, false});
+            }
+            if (range.lo < mid) pending.push_back({range.lo, mid, range.depth + 1, node, true});
         }
+
+        updateSubtree(top);
+        return top;
     }
 
-    void destroyTree(RBNode<T>* node)
+    // Deletes every node without a stack: left children are rotated up until the
+    // current node has none, then it is deleted and its right subtree moves in.
+    static void destroyTree(Node* node)
     {
-        if (node)
+        while (node)
         {
-            destroyTree(node->left);
-            destroyTree(node->right);
-            delete node;
+            if (node->left)
+            {
+                Node* left = node->left;
+                node->left = left->right;
+                left->right = node;
+                node = left;
+            }
+            else
+            {
+                Node* right = node->right;
+                delete node;
+                node = right;
+            }
         }
     }
 
    public:
-    RBTree() : root(nullptr) {}
+    class iterator
+    {
+       private:
+        Node* node;
+        const RBTree* tree;
+
+        friend class RBTree;
+
+        iterator(Node* current, const RBTree* owner) : node(current), tree(owner) {}
+
+       public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() : node(nullptr), tree(nullptr) {}
+
+        const T& operator*() const { return node->data; }
+
+        const T* operator->() const { return &node->data; }
+
+        size_t count() const { return node->count; }
+
+        iterator& operator++()
+        {
+            node = successor(node);
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        iterator& operator--()
+        {
+            node = node ? predecessor(node) : tree->rightmost;
+            return *this;
+        }
+
+        iterator operator--(int)
+        {
+            iterator previous = *this;
+            --*this;
+            return previous;
+        }
+
+        bool operator==(const iterator& other) const { return node == other.node; }
+    };
+
+    RBTree(bool countDuplicates = false, Compare comparator = Compare())
+        : root(nullptr),
+          leftmost(nullptr),
+          rightmost(nullptr),
+          finger(nullptr),
+          nodeCount(0),
+          counted(countDuplicates),
+          fingerInsertion(false),
+          bulkLoading(false),
+          compare(comparator)
+    {
+    }
 
     ~RBTree() { destroyTree(root); }
 
-    void insert(T value) { insertNode(value); }
+    void insert(const T& value) { insertNode(value); }
 
-    void remove(T value)
+    // Inserts value right before hint when it belongs there, in amortized O(1);
+    // otherwise falls back to a descent from the root. Same contract as the hinted
+    // std::set::insert.
+    iterator insert(iterator hint, const T& value)
     {
-        RBNode<T>* node = searchNode(root, value);
-        if (node != nullptr)
+        Node* next = hint.node;
+        if (root == nullptr) return iterator(insertBelow(root, value), this);
+
+        if (next != nullptr)
+        {
+            auto order = compare(value, next->data);
+            if (order == 0) return iterator(addDuplicate(next), this);
+            if (order > 0) return iterator(insertBelow(root, value), this);
+        }
+
+        Node* previous = next ? predecessor(next) : rightmost;
+        if (previous != nullptr)
+        {
+            auto order = compare(previous->data, value);
+            if (order == 0) return iterator(addDuplicate(previous), this);
+            if (order > 0) return iterator(insertBelow(root, value), this);
+        }
+
+        if (next == nullptr) return iterator(attachNode(rightmost, false, value), this);
+        if (next->left == nullptr) return iterator(attachNode(next, true, value), this);
+        return iterator(attachNode(previous, false, value), this);
+    }
+
+    // Puts a LookupCache with the given number of slots in front of search and
+    // count. Inserts and removes invalidate the affected key, so results stay exact.
+    // Lookups then write to the cache: a tree with the cache enabled must not be
+    // searched from several threads at once, even under a shared lock. Slots are
+    // keyed by std::hash<T>, so the cache needs the default ThreeWayCompare.
+    void enableLookupCache(size_t slots)
+        requires hashMatchesCompare
+    {
+        cache = std::make_unique<LookupCache<T, Node*>>(slots);
+    }
+
+    void disableLookupCache() { cache.reset(); }
+
+    bool hasLookupCache() const { return cache != nullptr; }
+
+    LookupCacheStats lookupCacheStats() const
+    {
+        return cache ? cache->getStats() : LookupCacheStats();
+    }
+
+    void resetLookupCacheStats()
+    {
+        if (cache) cache->resetStats();
+    }
+
+    // Keeps a CountingBloomFilter of the distinct keys next to the tree so that
+    // search and count reject most absent keys with one cache-line probe. It is
+    // sized for expectedKeys, but at least a quarter above the current size, at
+    // the given false-positive rate, and rebuilt at twice the size when the tree
+    // outgrows it. Like the lookup cache it counts queries, so concurrent
+    // searches are not allowed, and it hashes with std::hash<T>, so it needs the
+    // default ThreeWayCompare.
+    void enableMembershipFilter(double falsePositiveRate, size_t expectedKeys = 0)
+        requires hashMatchesCompare
+    {
+        rebuildFilter(std::max(expectedKeys, nodeCount + nodeCount / 4), falsePositiveRate);
+    }
+
+    void disableMembershipFilter() { filter.reset(); }
+
+    bool hasMembershipFilter() const { return filter != nullptr; }
+
+    MembershipFilterStats membershipFilterStats() const
+    {
+        return filter ? filter->getStats() : MembershipFilterStats();
+    }
+
+    void resetMembershipFilterStats()
+    {
+        if (filter) filter->resetStats();
+    }
+
+    // When enabled, insert(value) starts from the previous insertion point instead
+    // of the root, which makes sorted and nearly sorted streams cheap.
+    void setFingerInsertion(bool enabled)
+    {
+        fingerInsertion = enabled;
+        finger = nullptr;
+    }
+
+    // Between beginBulkLoad and endBulkLoad, inserts and removes skip the weight and
+    // aggregate updates along the path to the root; endBulkLoad recomputes them in
+    // one O(n) pass. rank, kth, totalCount and the aggregates are stale until then.
+    void beginBulkLoad() { bulkLoading = true; }
+
+    void endBulkLoad()
+    {
+        bulkLoading = false;
+        updateSubtree(root);
+    }
+
+    iterator begin() const { return iterator(leftmost, this); }
+
+    iterator end() const { return iterator(nullptr, this); }
+
+    iterator find(const T& value) const { return iterator(searchNode(root, value), this); }
+
+    iterator lowerBound(const T& value) const
+    {
+        Node* result = nullptr;
+        for (Node* current = root; current != nullptr;)
+        {
+            if (less(current->data, value))
+            {
+                current = current->right;
+            }
+            else
+            {
+                result = current;
+                current = current->left;
+            }
+        }
+        return iterator(result, this);
+    }
+
+    // Replaces the contents with a balanced tree built in O(n) from ascending keys.
+    // Every level is full except possibly the deepest, which is colored red.
+    void buildFromSorted(const std::vector<T>& sorted)
+    {
+        std::vector<T> keys;
+        std::vector<size_t> counts;
+        for (size_t i = 0; i < sorted.size(); i++)
+        {
+            if (i > 0)
+            {
+                auto order = compare(sorted[i - 1], sorted[i]);
+                if (order > 0)
+                {
+                    throw std::invalid_argument("Keys are not sorted");
+                }
+                if (order == 0)
+                {
+                    if (counted) counts.back()++;
+                    continue;
+                }
+            }
+            keys.push_back(sorted[i]);
+            counts.push_back(1);
+        }
+
+        destroyTree(root);
+        root = nullptr;
+        finger = nullptr;
+        if (cache) cache->clear();
+        nodeCount = keys.size();
+
+        size_t fullLevels = 0;
+        while ((size_t(2) << fullLevels) - 1 <= keys.size()) fullLevels++;
+        root = buildBalanced(keys, counts, fullLevels);
+
+        leftmost = root;
+        rightmost = root;
+        while (leftmost && leftmost->left) leftmost = leftmost->left;
+        while (rightmost && rightmost->right) rightmost = rightmost->right;
+
+        if constexpr (hashable)
+        {
+            if (filter)
+            {
+                rebuildFilter(std::max(filter->getCapacity(), nodeCount), filter->getTargetRate());
+            }
+        }
+    }
+
+    void remove(const T& value)
+    {
+        Node* node = searchNode(root, value);
+        if (node == nullptr)
+        {
+            return;
+        }
+
+        if (node->count > 1)
+        {
+            node->count--;
+            updatePathToRoot(node);
+        }
+        else
         {
             deleteNode(node);
         }
     }
 
-    bool search(T value) { return searchNode(root, value) != nullptr; }
+    bool search(const T& value) const { return findNode(value) != nullptr; }
+
+    size_t size() const { return nodeCount; }
+
+    size_t totalCount() const { return weightOf(root); }
+
+    AggregateValue aggregate() const { return aggregateOf(root); }
+
+    // Finds the highest node inside [lo, hi], then folds the aggregates along the
+    // two paths below it. Those paths compare once per level; the descent to the
+    // split compares against hi only when the node is above lo, so it makes one or
+    // two comparisons per level.
+    AggregateValue rangeQuery(const T& lo, const T& hi) const
+    {
+        if (less(hi, lo)) return Aggregate::identity();
+
+        Node* split = root;
+        while (split != nullptr)
+        {
+            auto order = compare(split->data, lo);
+            if (order < 0)
+                split = split->right;
+            else if (order > 0 && less(hi, split->data))
+                split = split->left;
+            else
+                break;
+        }
+        if (split == nullptr) return Aggregate::identity();
+
+        AggregateValue leftPart = Aggregate::identity();
+        for (Node* node = split->left; node != nullptr;)
+        {
+            if (less(node->data, lo))
+            {
+                node = node->right;
+            }
+            else
+            {
+                leftPart = Aggregate::combine(
+                    Aggregate::combine(liftNode(node), aggregateOf(node->right)), leftPart);
+                node = node->left;
+            }
+        }
+
+        AggregateValue rightPart = Aggregate::identity();
+        for (Node* node = split->right; node != nullptr;)
+        {
+            if (less(hi, node->data))
+            {
+                node = node->left;
+            }
+            else
+            {
+                rightPart = Aggregate::combine(
+                    rightPart, Aggregate::combine(aggregateOf(node->left), liftNode(node)));
+                node = node->right;
+            }
+        }
+
+        return Aggregate::combine(leftPart, Aggregate::combine(liftNode(split), rightPart));
+    }
+
+    bool isCounted() const { return counted; }
+
+    size_t count(const T& value) const
+    {
+        Node* node = findNode(value);
+        return node ? node->count : 0;
+    }
+
+    size_t rank(const T& value) const
+    {
+        size_t smaller = 0;
+        Node* current = root;
+        while (current != nullptr)
+        {
+            if (less(current->data, value))
+            {
+                smaller += weightOf(current->left) + current->count;
+                current = current->right;
+            }
+            else
+            {
+                current = current->left;
+            }
+        }
+        return smaller;
+    }
+
+    T kth(size_t index) const
+    {
+        if (index >= totalCount())
+        {
+            throw std::out_of_range("Rank out of range");
+        }
+
+        Node* current = root;
+        while (true)
+        {
+            size_t leftWeight = weightOf(current->left);
+            if (index < leftWeight)
+            {
+                current = current->left;
+            }
+            else if (index < leftWeight + current->count)
+            {
+                return current->data;
+            }
+            else
+            {
+                index -= leftWeight + current->count;
+                current = current->right;
+            }
+        }
+    }
 
     void breadthFirstTraversal(std::function<void(T)> visit)
     {
         if (!root) return;
 
-        std::queue<RBNode<T>*> q;
+        std::queue<Node*> q;
         q.push(root);
 
         while (!q.empty())
         {
-            RBNode<T>* current = q.front();
+            Node* current = q.front();
             q.pop();
 
-            visit(current->data);
+            for (size_t i = 0; i < current->count; i++) visit(current->data);
 
             if (current->left) q.push(current->left);
             if (current->right) q.push(current->right);
@@ -421,15 +1154,15 @@ class RBTree
     {
         if (!root) return;
 
-        std::stack<RBNode<T>*> s;
+        std::stack<Node*> s;
         s.push(root);
 
         while (!s.empty())
         {
-            RBNode<T>* current = s.top();
+            Node* current = s.top();
             s.pop();
 
-            visit(current->data);
+            for (size_t i = 0; i < current->count; i++) visit(current->data);
 
             if (current->right) s.push(current->right);
             if (current->left) s.push(current->left);
@@ -440,8 +1173,8 @@ class RBTree
     {
         if (!root) return;
 
-        std::stack<RBNode<T>*> s;
-        RBNode<T>* current = root;
+        std::stack<Node*> s;
+        Node* current = root;
 
         while (current || !s.empty())
         {
@@ -454,7 +1187,7 @@ class RBTree
             current = s.top();
             s.pop();
 
-            visit(current->data);
+            for (size_t i = 0; i < current->count; i++) visit(current->data);
 
             current = current->right;
         }
@@ -464,12 +1197,12 @@ class RBTree
     {
         if (!root) return;
 
-        std::stack<RBNode<T>*> s1, s2;
+        std::stack<Node*> s1, s2;
         s1.push(root);
 
         while (!s1.empty())
         {
-            RBNode<T>* current = s1.top();
+            Node* current = s1.top();
             s1.pop();
             s2.push(current);
 
@@ -479,26 +1212,27 @@ class RBTree
 
         while (!s2.empty())
         {
-            visit(s2.top()->data);
+            Node* node = s2.top();
+            for (size_t i = 0; i < node->count; i++) visit(node->data);
             s2.pop();
         }
     }
 
-    RBNode<T>* getRoot() const { return root; }
+    Node* getRoot() const { return root; }
 
     void breadthFirstTraversalWithColor(std::function<void(T, Color)> visit)
     {
         if (!root) return;
 
-        std::queue<RBNode<T>*> q;
+        std::queue<Node*> q;
         q.push(root);
 
         while (!q.empty())
         {
-            RBNode<T>* current = q.front();
+            Node* current = q.front();
             q.pop();
 
-            visit(current->data, current->color);
+            for (size_t i = 0; i < current->count; i++) visit(current->data, current->color);
 
             if (current->left) q.push(current->left);
             if (current->right) q.push(current->right);
@@ -509,15 +1243,15 @@ class RBTree
     {
         if (!root) return;
 
-        std::stack<RBNode<T>*> s;
+        std::stack<Node*> s;
         s.push(root);
 
         while (!s.empty())
         {
-            RBNode<T>* current = s.top();
+            Node* current = s.top();
             s.pop();
 
-            visit(current->data, current->color);
+            for (size_t i = 0; i < current->count; i++) visit(current->data, current->color);
 
             if (current->right) s.push(current->right);
             if (current->left) s.push(current->left);
@@ -528,8 +1262,8 @@ class RBTree
     {
         if (!root) return;
 
-        std::stack<RBNode<T>*> s;
-        RBNode<T>* current = root;
+        std::stack<Node*> s;
+        Node* current = root;
 
         while (current || !s.empty())
         {
@@ -542,7 +1276,7 @@ class RBTree
             current = s.top();
             s.pop();
 
-            visit(current->data, current->color);
+            for (size_t i = 0; i < current->count; i++) visit(current->data, current->color);
 
             current = current->right;
         }
@@ -552,12 +1286,12 @@ class RBTree
     {
         if (!root) return;
 
-        std::stack<RBNode<T>*> s1, s2;
+        std::stack<Node*> s1, s2;
         s1.push(root);
 
         while (!s1.empty())
         {
-            RBNode<T>* current = s1.top();
+            Node* current = s1.top();
             s1.pop();
             s2.push(current);
 
@@ -567,8 +1301,8 @@ class RBTree
 
         while (!s2.empty())
         {
-            RBNode<T>* node = s2.top();
-            visit(node->data, node->color);
+            Node* node = s2.top();
+            for (size_t i = 0; i < node->count; i++) visit(node->data, node->color);
             s2.pop();
         }
     }
@@ -0,0 +1,166 @@
+#ifndef SHARDEDRBTREE_H
+#define SHARDEDRBTREE_H
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "RBTree.h"
+
+template <typename T>
+class ShardedRBTree
+{
+   private:
+    struct alignas(64) Shard
+    {
+        std::unique_ptr<RBTree<T>> tree;
+        std::shared_mutex mutex;
+
+        Shard() : tree(std::make_unique<RBTree<T>>()) {}
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<T> boundaries;
+    mutable std::shared_mutex layoutMutex;
+
+    static std::vector<T> pickBoundaries(std::vector<T> sample, size_t shardCount)
+    {
+        if (!std::is_sorted(sample.begin(), sample.end()))
+        {
+            std::sort(sample.begin(), sample.end());
+        }
+        sample.erase(std::unique(sample.begin(), sample.end()), sample.end());
+
+        std::vector<T> result;
+        for (size_t i = 1; i < shardCount && !sample.empty(); i++)
+        {
+            T boundary = sample[i * sample.size() / shardCount];
+            if (result.empty() || result.back() < boundary) result.push_back(boundary);
+        }
+        return result;
+    }
+
+    Shard& shardFor(const T& value) const
+    {
+        size_t index = std::upper_bound(boundaries.begin(), boundaries.end(), value) -
+                       boundaries.begin();
+        return *shards[index];
+    }
+
+   public:
+    ShardedRBTree(size_t shardCount, const std::vector<T>& sample)
+    {
+        if (shardCount == 0) shardCount = 1;
+        for (size_t i = 0; i < shardCount; i++)
+        {
+            shards.push_back(std::make_unique<Shard>());
+        }
+        boundaries = pickBoundaries(sample, shardCount);
+    }
+
+    void insert(T value)
+    {
+        std::shared_lock<std::shared_mutex> layout(layoutMutex);
+        Shard& shard = shardFor(value);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.tree->insert(value);
+    }
+
+    void remove(T value)
+    {
+        std::shared_lock<std::shared_mutex> layout(layoutMutex);
+        Shard& shard = shardFor(value);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.tree->remove(value);
+    }
+
+    bool search(T value)
+    {
+        std::shared_lock<std::shared_mutex> layout(layoutMutex);
+        Shard& shard = shardFor(value);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        return shard.tree->search(value);
+    }
+
+    void inorderTraversal(std::function<void(T)> visit)
+    {
+        std::shared_lock<std::shared_mutex> layout(layoutMutex);
+        for (const std::unique_ptr<Shard>& shard : shards)
+        {
+            std::shared_lock<std::shared_mutex> lock(shard->mutex);
+            shard->tree->inorderTraversal(visit);
+        }
+    }
+
+    std::vector<size_t> shardSizes() const
+    {
+        std::shared_lock<std::shared_mutex> layout(layoutMutex);
+        std::vector<size_t> sizes;
+        for (const std::unique_ptr<Shard>& shard : shards)
+        {
+            std::shared_lock<std::shared_mutex> lock(shard->mutex);
+            sizes.push_back(shard->tree->size());
+        }
+        return sizes;
+    }
+
+    size_t size() const
+    {
+        size_t total = 0;
+        for (size_t shardSize : shardSizes()) total += shardSize;
+        return total;
+    }
+
+    double skew() const
+    {
+        std::vector<size_t> sizes = shardSizes();
+        size_t total = 0;
+        size_t largest = 0;
+        for (size_t shardSize : sizes)
+        {
+            total += shardSize;
+            largest = std::max(largest, shardSize);
+        }
+        if (total == 0) return 1.0;
+        return static_cast<double>(largest) * sizes.size() / total;
+    }
+
+    // Shards are walked in order, so keys comes out sorted and every new shard is
+    // a contiguous slice of it, built in linear time by buildFromSorted.
+    bool rebalance(double maxSkew)
+    {
+        std::unique_lock<std::shared_mutex> layout(layoutMutex);
+
+        std::vector<T> keys;
+        size_t largest = 0;
+        for (const std::unique_ptr<Shard>& shard : shards)
+        {
+            largest = std::max(largest, shard->tree->size());
+            shard->tree->inorderTraversal([&keys](T val) { keys.push_back(val); });
+        }
+        if (keys.empty() || static_cast<double>(largest) * shards.size() / keys.size() <= maxSkew)
+        {
+            return false;
+        }
+
+        boundaries = pickBoundaries(keys, shards.size());
+        auto sliceBegin = keys.begin();
+        for (size_t i = 0; i < shards.size(); i++)
+        {
+            auto sliceEnd = i < boundaries.size()
+                                ? std::lower_bound(sliceBegin, keys.end(), boundaries[i])
+                                : keys.end();
+            shards[i]->tree = std::make_unique<RBTree<T>>();
+            shards[i]->tree->buildFromSorted(std::vector<T>(sliceBegin, sliceEnd));
+            sliceBegin = sliceEnd;
+        }
+        return true;
+    }
+
+    size_t shardCount() const { return shards.size(); }
+};
+
+#endif
\ No newline at end of file
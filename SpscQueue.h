@@ -0,0 +1,96 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class SpscQueue
+{
+   private:
+    std::vector<T> slots;
+    size_t mask;
+
+    alignas(64) std::atomic<size_t> head;
+    size_t cachedTail;
+
+    alignas(64) std::atomic<size_t> tail;
+    size_t cachedHead;
+
+    alignas(64) std::atomic<bool> closed;
+
+    static size_t roundUp(size_t capacity)
+    {
+        size_t result = 1;
+        while (result < capacity) result <<= 1;
+        return result;
+    }
+
+   public:
+    SpscQueue(size_t capacity)
+        : slots(roundUp(capacity)),
+          mask(slots.size() - 1),
+          head(0),
+          cachedTail(0),
+          tail(0),
+          cachedHead(0),
+          closed(false)
+    {
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    bool tryPush(T& value)
+    {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position - cachedHead == slots.size())
+        {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead == slots.size()) return false;
+        }
+        slots[position & mask] = std::move(value);
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value)
+    {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (position == cachedTail)
+        {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (position == cachedTail) return false;
+        }
+        value = std::move(slots[position & mask]);
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool push(T& value, const std::atomic<bool>& cancelled)
+    {
+        while (!tryPush(value))
+        {
+            if (cancelled.load(std::memory_order_relaxed)) return false;
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    bool pop(T& value)
+    {
+        while (!tryPop(value))
+        {
+            if (closed.load(std::memory_order_acquire)) return tryPop(value);
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    void close() { closed.store(true, std::memory_order_release); }
+};
+
+#endif
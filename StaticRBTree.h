@@ -0,0 +1,231 @@
+#ifndef STATICRBTREE_H
+#define STATICRBTREE_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+#include "Parser.h"
+#include "RBTree.h"
+
+template <size_t Length>
+struct FixedString
+{
+    char text[Length];
+
+    constexpr FixedString(const char (&literal)[Length])
+    {
+        std::copy(literal, literal + Length, text);
+    }
+
+    constexpr std::string_view view() const { return std::string_view(text, Length - 1); }
+};
+
+// Compile-time front end of TreeScanner: accepts the same tree format and rejects
+// the same inputs as Parser, but only collects the keys in preorder. Errors are
+// thrown, so a malformed literal fails to compile.
+template <typename T>
+class StaticTreeParser
+{
+   private:
+    std::string_view input;
+
+    template <typename Out>
+    struct Writer
+    {
+        Out& out;
+        size_t written;
+
+        constexpr void open(const T& value, size_t) { out[written++] = value; }
+
+        constexpr void close() {}
+    };
+
+   public:
+    constexpr StaticTreeParser(std::string_view text) : input(text) {}
+
+    static constexpr size_t nodeCount(std::string_view text)
+    {
+        return static_cast<size_t>(std::count(text.begin(), text.end(), '('));
+    }
+
+    // Writes the keys in preorder to out, which must hold nodeCount(text) values.
+    template <typename Out>
+    constexpr size_t parse(Out& out)
+    {
+        Writer<Out> writer{out, 0};
+        TreeScanner<T> scanner;
+        scanner.feed(input, writer);
+        scanner.finish();
+        return writer.written;
+    }
+};
+
+template <typename T>
+struct StaticRBNode
+{
+    T data;
+    uint32_t left;
+    uint32_t right;
+    Color color;
+};
+
+// Red-black tree laid out in a flat array in breadth-first order, so the upper
+// levels that every lookup touches share a few cache lines. It is built from
+// sorted keys with the same shape and coloring as RBTree::buildFromSorted, and
+// everything is constexpr, so a constexpr instance lives in read-only data.
+// Children are 32-bit indices to keep nodes small.
+template <typename T, size_t Capacity>
+class StaticRBTree
+{
+   public:
+    static constexpr uint32_t none = static_cast<uint32_t>(Capacity);
+    static_assert(Capacity < UINT32_MAX, "StaticRBTree indexes nodes with 32 bits");
+
+   private:
+    std::array<StaticRBNode<T>, Capacity> nodes{};
+    size_t count = 0;
+
+   public:
+    constexpr StaticRBTree() = default;
+
+    template <typename Keys>
+    constexpr StaticRBTree(Keys keys, size_t keyCount)
+    {
+        std::sort(keys.begin(), keys.begin() + keyCount);
+        count = static_cast<size_t>(std::unique(keys.begin(), keys.begin() + keyCount) -
+                                    keys.begin());
+
+        size_t fullLevels = 0;
+        while ((size_t(2) << fullLevels) - 1 <= count) fullLevels++;
+
+        struct Range
+        {
+            size_t lo;
+            size_t hi;
+            size_t depth;
+        };
+
+        std::array<Range, Capacity> queue{};
+        size_t head = 0;
+        size_t tail = 0;
+        if (count > 0) queue[tail++] = {0, count, 0};
+
+        while (head < tail)
+        {
+            Range range = queue[head];
+            size_t index = head++;
+            size_t mid = range.lo + (range.hi - range.lo) / 2;
+
+            StaticRBNode<T>& node = nodes[index];
+            node.data = keys[mid];
+            node.color = range.depth == fullLevels ? RED : BLACK;
+            node.left = none;
+            node.right = none;
+
+            if (range.lo < mid)
+            {
+                node.left = static_cast<uint32_t>(tail);
+                queue[tail++] = {range.lo, mid, range.depth + 1};
+            }
+            if (mid + 1 < range.hi)
+            {
+                node.right = static_cast<uint32_t>(tail);
+                queue[tail++] = {mid + 1, range.hi, range.depth + 1};
+            }
+        }
+    }
+
+    constexpr size_t size() const { return count; }
+
+    constexpr bool empty() const { return count == 0; }
+
+    constexpr const StaticRBNode<T>& node(size_t index) const { return nodes[index]; }
+
+    constexpr uint32_t root() const { return count > 0 ? 0 : none; }
+
+    constexpr bool search(const T& value) const
+    {
+        uint32_t index = root();
+        while (index != none)
+        {
+            const StaticRBNode<T>& current = nodes[index];
+            if (current.data == value) return true;
+            index = value < current.data ? current.left : current.right;
+        }
+        return false;
+    }
+
+    // Checks the red-black properties: black root, no red node with a red child and
+    // the same number of black nodes on every root-to-leaf path.
+    constexpr bool isValid() const
+    {
+        if (count == 0) return true;
+        if (nodes[0].color != BLACK) return false;
+
+        std::array<size_t, Capacity> blackDepth{};
+        size_t leafBlackDepth = 0;
+        bool leafSeen = false;
+        for (size_t i = 0; i < count; i++)
+        {
+            const StaticRBNode<T>& current = nodes[i];
+            size_t depth = blackDepth[i] + (current.color == BLACK ? 1 : 0);
+            for (uint32_t child : {current.left, current.right})
+            {
+                if (child == none)
+                {
+                    if (!leafSeen) leafBlackDepth = depth;
+                    leafSeen = true;
+                    if (depth != leafBlackDepth) return false;
+                    continue;
+                }
+                if (current.color == RED && nodes[child].color == RED) return false;
+                if (!(child > i && child < count)) return false;
+                blackDepth[child] = depth;
+            }
+        }
+        return true;
+    }
+
+    void inorderTraversal(std::function<void(T)> visit) const
+    {
+        std::array<uint32_t, 64> stack{};
+        size_t top = 0;
+        uint32_t index = root();
+
+        while (index != none || top > 0)
+        {
+            while (index != none)
+            {
+                stack[top++] = index;
+                index = nodes[index].left;
+            }
+            index = stack[--top];
+            visit(nodes[index].data);
+            index = nodes[index].right;
+        }
+    }
+};
+
+template <typename T, size_t N>
+constexpr StaticRBTree<T, N> makeStaticRBTree(const std::array<T, N>& keys)
+{
+    return StaticRBTree<T, N>(keys, N);
+}
+
+// Builds a StaticRBTree from a tree-format literal at compile time:
+//     constexpr auto primes = parseStaticRBTree<int, "(7 (3 (2) (5)) (11))">();
+template <typename T, FixedString Text>
+constexpr auto parseStaticRBTree()
+{
+    constexpr size_t capacity = StaticTreeParser<T>::nodeCount(Text.view());
+    std::array<T, capacity> keys{};
+    StaticTreeParser<T> parser(Text.view());
+    size_t keyCount = parser.parse(keys);
+    return StaticRBTree<T, capacity>(keys, keyCount);
+}
+
+#endif
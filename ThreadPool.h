@@ -0,0 +1,85 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+   private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskReady;
+    std::condition_variable allDone;
+    size_t pending;
+    bool stopping;
+
+    void workerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                taskReady.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;
+
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+
+            task();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) allDone.notify_all();
+        }
+    }
+
+   public:
+    ThreadPool(size_t threadCount) : pending(0), stopping(false)
+    {
+        if (threadCount == 0) threadCount = 1;
+        for (size_t i = 0; i < threadCount; i++)
+        {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        taskReady.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push(std::move(task));
+            pending++;
+        }
+        taskReady.notify_one();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        allDone.wait(lock, [this]() { return pending == 0; });
+    }
+
+    size_t size() const { return workers.size(); }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,304 @@
+#ifndef TREEEXPORT_H
+#define TREEEXPORT_H
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "BinaryTree.h"
+#include "RBTree.h"
+
+enum class ExportFormat
+{
+    Dot,
+    Json,
+    Csv
+};
+
+inline ExportFormat parseExportFormat(const std::string& name)
+{
+    if (name == "dot") return ExportFormat::Dot;
+    if (name == "json") return ExportFormat::Json;
+    if (name == "csv") return ExportFormat::Csv;
+    throw std::runtime_error("Unknown export format: " + name);
+}
+
+class ExportBuffer
+{
+   private:
+    FILE* file;
+    std::vector<char> buffer;
+    size_t used;
+    size_t written;
+
+   public:
+    ExportBuffer(const std::string& path)
+        : file(std::fopen(path.c_str(), "wb")), buffer(1 << 22), used(0), written(0)
+    {
+        if (!file)
+        {
+            throw std::runtime_error("Cannot open output file: " + path);
+        }
+    }
+
+    ExportBuffer(const ExportBuffer&) = delete;
+    ExportBuffer& operator=(const ExportBuffer&) = delete;
+
+    ~ExportBuffer()
+    {
+        if (file) std::fclose(file);
+    }
+
+    void flush()
+    {
+        if (std::fwrite(buffer.data(), 1, used, file) != used)
+        {
+            throw std::runtime_error("Write failed");
+        }
+        written += used;
+        used = 0;
+    }
+
+    void close()
+    {
+        flush();
+        FILE* closing = file;
+        file = nullptr;
+        if (std::fclose(closing) != 0)
+        {
+            throw std::runtime_error("Write failed");
+        }
+    }
+
+    void put(char c)
+    {
+        if (used == buffer.size()) flush();
+        buffer[used++] = c;
+    }
+
+    void put(std::string_view text)
+    {
+        if (buffer.size() - used < text.size()) flush();
+        if (text.size() > buffer.size())
+        {
+            for (char c : text) put(c);
+            return;
+        }
+        std::memcpy(buffer.data() + used, text.data(), text.size());
+        used += text.size();
+    }
+
+    template <typename N>
+    void putNumber(N value)
+    {
+        if (buffer.size() - used < 64) flush();
+        std::to_chars_result result =
+            std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), value);
+        used = result.ptr - buffer.data();
+    }
+
+    size_t bytesWritten() const { return written + used; }
+};
+
+// Writes one node per record in preorder. Every record carries its parent's id,
+// so DOT, JSON and CSV all stay flat and the writer keeps no per-node state.
+template <typename T>
+class TreeExportWriter
+{
+   private:
+    ExportBuffer out;
+    ExportFormat format;
+    size_t nodes;
+
+   public:
+    static constexpr size_t noParent = std::numeric_limits<size_t>::max();
+
+    TreeExportWriter(const std::string& path, ExportFormat exportFormat)
+        : out(path), format(exportFormat), nodes(0)
+    {
+    }
+
+    void begin(const char* name)
+    {
+        switch (format)
+        {
+            case ExportFormat::Dot:
+                out.put("digraph ");
+                out.put(name);
+                out.put(" {\n  node [shape=circle];\n");
+                break;
+            case ExportFormat::Json:
+                out.put("{\"tree\": \"");
+                out.put(name);
+                out.put("\", \"nodes\": [");
+                break;
+            case ExportFormat::Csv:
+                out.put("id,parent,side,value,color,count\n");
+                break;
+        }
+    }
+
+    void node(size_t id, size_t parent, char side, const T& value, const char* color,
+              size_t count)
+    {
+        switch (format)
+        {
+            case ExportFormat::Dot:
+                out.put("  n");
+                out.putNumber(id);
+                out.put(" [label=\"");
+                out.putNumber(value);
+                if (count > 1)
+                {
+                    out.put(" x");
+                    out.putNumber(count);
+                }
+                out.put('"');
+                if (color)
+                {
+                    out.put(", style=filled, fontcolor=white, fillcolor=");
+                    out.put(color);
+                }
+                out.put("];\n");
+                if (parent != noParent)
+                {
+                    out.put("  n");
+                    out.putNumber(parent);
+                    out.put(" -> n");
+                    out.putNumber(id);
+                    out.put(side == 'L' ? " [label=\"L\"];\n" : " [label=\"R\"];\n");
+                }
+                break;
+
+            case ExportFormat::Json:
+                out.put(nodes == 0 ? "\n{\"id\": " : ",\n{\"id\": ");
+                out.putNumber(id);
+                out.put(", \"parent\": ");
+                if (parent == noParent)
+                {
+                    out.put("null, \"side\": null");
+                }
+                else
+                {
+                    out.putNumber(parent);
+                    out.put(side == 'L' ? ", \"side\": \"L\"" : ", \"side\": \"R\"");
+                }
+                out.put(", \"value\": ");
+                out.putNumber(value);
+                if (color)
+                {
+                    out.put(", \"color\": \"");
+                    out.put(color);
+                    out.put("\", \"count\": ");
+                    out.putNumber(count);
+                }
+                out.put('}');
+                break;
+
+            case ExportFormat::Csv:
+                out.putNumber(id);
+                out.put(',');
+                if (parent != noParent)
+                {
+                    out.putNumber(parent);
+                    out.put(',');
+                    out.put(side);
+                }
+                else
+                {
+                    out.put(',');
+                }
+                out.put(',');
+                out.putNumber(value);
+                out.put(',');
+                if (color) out.put(color);
+                out.put(',');
+                out.putNumber(count);
+                out.put('\n');
+                break;
+        }
+        nodes++;
+    }
+
+    void end()
+    {
+        switch (format)
+        {
+            case ExportFormat::Dot:
+                out.put("}\n");
+                break;
+            case ExportFormat::Json:
+                out.put("\n]}\n");
+                break;
+            case ExportFormat::Csv:
+                break;
+        }
+        out.close();
+    }
+
+    size_t nodeCount() const { return nodes; }
+
+    size_t bytesWritten() const { return out.bytesWritten(); }
+};
+
+struct ExportResult
+{
+    size_t nodes;
+    size_t bytes;
+};
+
+template <typename T>
+ExportResult exportBinaryTree(BinaryTree<T>& tree, const std::string& path, ExportFormat format)
+{
+    TreeExportWriter<T> writer(path, format);
+    writer.begin("BinaryTree");
+    tree.forEachNode([&writer](size_t id, size_t parent, char side, T value)
+                     { writer.node(id, parent, side, value, nullptr, 1); });
+    writer.end();
+    return {writer.nodeCount(), writer.bytesWritten()};
+}
+
+template <typename T, typename Aggregate, typename Compare>
+ExportResult exportRBTree(const RBTree<T, Aggregate, Compare>& tree, const std::string& path,
+                          ExportFormat format)
+{
+    using Node = typename RBTree<T, Aggregate, Compare>::Node;
+
+    struct Pending
+    {
+        Node* node;
+        size_t parent;
+        char side;
+    };
+
+    TreeExportWriter<T> writer(path, format);
+    writer.begin("RBTree");
+
+    std::vector<Pending> stack;
+    if (tree.getRoot()) stack.push_back({tree.getRoot(), TreeExportWriter<T>::noParent, 0});
+
+    size_t nextId = 0;
+    while (!stack.empty())
+    {
+        Pending current = stack.back();
+        stack.pop_back();
+
+        size_t id = nextId++;
+        Node* node = current.node;
+        writer.node(id, current.parent, current.side, node->data,
+                    node->color == RED ? "red" : "black", node->count);
+
+        if (node->right) stack.push_back({node->right, id, 'R'});
+        if (node->left) stack.push_back({node->left, id, 'L'});
+    }
+
+    writer.end();
+    return {writer.nodeCount(), writer.bytesWritten()};
+}
+
+#endif
@@ -0,0 +1,367 @@
+#ifndef TREELOADER_H
+#define TREELOADER_H
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <shared_mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BinaryTree.h"
+#include "Parser.h"
+#include "RBTree.h"
+#include "SpscQueue.h"
+
+inline std::string readFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Cannot open file: " + filename);
+    }
+
+    std::streamoff size = file.tellg();
+    if (size < 0)
+    {
+        std::stringstream buffer;
+        file.seekg(0);
+        buffer << file.rdbuf();
+        return buffer.str();
+    }
+
+    std::string content(static_cast<size_t>(size), '\0');
+    file.seekg(0);
+    file.read(content.data(), size);
+    content.resize(static_cast<size_t>(file.gcount()));
+    return content;
+}
+
+struct LoadOptions
+{
+    bool counted = false;
+    bool shareSubtrees = false;
+    bool keepBinaryTree = true;
+};
+
+struct PipelineStats
+{
+    size_t bytes = 0;
+    size_t nodes = 0;
+    double readMs = 0;
+    double parseMs = 0;
+    double buildMs = 0;
+    double totalMs = 0;
+};
+
+template <typename T>
+struct TreeSet
+{
+    using RBTreeType = RBTree<T, RangeSummary<T>>;
+
+    std::unique_ptr<BinaryTree<T>> binaryTree;
+    std::unique_ptr<RBTreeType> rbTree;
+    std::string file;
+    bool counted = false;
+
+    // Held shared by lookups and exclusively by inserts and removes when the trees
+    // are used from more than one thread, as TreeServer does.
+    mutable std::shared_mutex mutex;
+};
+
+// Parser sink that inserts into an RBTree with finger insertion and deferred
+// weight updates; finish() leaves the tree ready for queries.
+template <typename T, typename Tree>
+class RBTreeBuilder final : public ParserSink<T>
+{
+   private:
+    Tree& tree;
+
+   public:
+    RBTreeBuilder(Tree& target) : tree(target)
+    {
+        tree.setFingerInsertion(true);
+        tree.beginBulkLoad();
+    }
+
+    void add(const T& value) override { tree.insert(value); }
+
+    void finish()
+    {
+        tree.endBulkLoad();
+        tree.setFingerInsertion(false);
+    }
+};
+
+template <typename T>
+void buildRBTree(TreeSet<T>& trees)
+{
+    using RBTreeType = typename TreeSet<T>::RBTreeType;
+    trees.rbTree = std::make_unique<RBTreeType>(trees.counted);
+    RBTreeBuilder<T, RBTreeType> builder(*trees.rbTree);
+    trees.binaryTree->traverse([&builder](T val) { builder.add(val); });
+    builder.finish();
+}
+
+template <typename T>
+class KeyCollector final : public ParserSink<T>
+{
+   public:
+    std::vector<T> keys;
+
+    void add(const T& value) override { keys.push_back(value); }
+};
+
+// With a sink, the keys also go to it in preorder during the same pass.
+template <typename T>
+std::unique_ptr<BinaryTree<T>> parseBinaryTree(const std::string& content,
+                                               const LoadOptions& options = {},
+                                               ParserSink<T>* sink = nullptr)
+{
+    auto binaryTree = std::make_unique<BinaryTree<T>>();
+    if (options.shareSubtrees)
+    {
+        auto interner = std::make_unique<NodeInterner<T>>();
+        Parser<T> parser(content, interner.get());
+        BinaryTreeNode<T>* treeRoot = parser.parse(sink);
+        binaryTree->setRoot(treeRoot, std::move(interner));
+    }
+    else
+    {
+        Parser<T> parser(content);
+        binaryTree->setRoot(parser.parse(sink));
+    }
+    return binaryTree;
+}
+
+// Keys of the tree in content, in preorder, without building the tree.
+template <typename T>
+std::vector<T> parseKeys(const std::string& content)
+{
+    KeyCollector<T> collector;
+    Parser<T> parser(content);
+    parser.parseInto(collector);
+    return std::move(collector.keys);
+}
+
+template <typename T>
+std::shared_ptr<TreeSet<T>> buildTreeSet(const std::string& content, const std::string& file,
+                                         const LoadOptions& options = {})
+{
+    using RBTreeType = typename TreeSet<T>::RBTreeType;
+    auto trees = std::make_shared<TreeSet<T>>();
+    trees->file = file;
+    trees->counted = options.counted;
+
+    if (options.keepBinaryTree)
+    {
+        trees->binaryTree = parseBinaryTree<T>(content, options);
+        buildRBTree(*trees);
+        return trees;
+    }
+
+    trees->binaryTree = std::make_unique<BinaryTree<T>>();
+    trees->rbTree = std::make_unique<RBTreeType>(options.counted);
+    RBTreeBuilder<T, RBTreeType> builder(*trees->rbTree);
+    Parser<T> parser(content);
+    parser.parseInto(builder);
+    builder.finish();
+    return trees;
+}
+
+template <typename T>
+std::shared_ptr<TreeSet<T>> openTreeSetLazily(std::string content, const std::string& file,
+                                              const LoadOptions& options = {})
+{
+    auto trees = std::make_shared<TreeSet<T>>();
+    trees->binaryTree = std::make_unique<BinaryTree<T>>();
+    trees->binaryTree->setLazySource(std::make_unique<LazyTreeSource<T>>(std::move(content)));
+    trees->file = file;
+    trees->counted = options.counted;
+    return trees;
+}
+
+// Reads, parses and builds on three threads at once: the reader hands fixed-size
+// chunks to a StreamingParser, which hands key batches to the RBTree builder running
+// on the calling thread. Buffers travel back through a second queue for reuse, so
+// memory stays bounded by the queue capacities rather than the file size. Without
+// keepBinaryTree the parser only validates and emits keys, and the TreeSet gets an
+// empty BinaryTree.
+template <typename T>
+std::shared_ptr<TreeSet<T>> loadTreeSetPipelined(const std::string& file,
+                                                 const LoadOptions& options = {},
+                                                 PipelineStats* stats = nullptr)
+{
+    using Clock = std::chrono::steady_clock;
+    const size_t chunkSize = 1 << 20;
+    const size_t batchSize = 4096;
+
+    auto msSince = [](Clock::time_point started)
+    { return std::chrono::duration<double, std::milli>(Clock::now() - started).count(); };
+
+    using RBTreeType = typename TreeSet<T>::RBTreeType;
+
+    auto started = Clock::now();
+    auto trees = std::make_shared<TreeSet<T>>();
+    trees->file = file;
+    trees->counted = options.counted;
+    trees->rbTree = std::make_unique<RBTreeType>(options.counted);
+
+    std::unique_ptr<NodeInterner<T>> interner;
+    if (options.shareSubtrees && options.keepBinaryTree)
+    {
+        interner = std::make_unique<NodeInterner<T>>();
+    }
+
+    SpscQueue<std::string> chunks(8);
+    SpscQueue<std::string> freeChunks(8);
+    SpscQueue<std::vector<T>> batches(64);
+    SpscQueue<std::vector<T>> freeBatches(64);
+    std::atomic<bool> cancelled(false);
+
+    PipelineStats local;
+    std::exception_ptr readError;
+    std::exception_ptr parseError;
+    BinaryTreeNode<T>* root = nullptr;
+
+    std::thread reader(
+        [&]()
+        {
+            try
+            {
+                std::ifstream in(file, std::ios::binary);
+                if (!in.is_open())
+                {
+                    throw std::runtime_error("Cannot open file: " + file);
+                }
+
+                while (!cancelled.load(std::memory_order_relaxed))
+                {
+                    std::string chunk;
+                    freeChunks.tryPop(chunk);
+                    chunk.resize(chunkSize);
+
+                    auto readStarted = Clock::now();
+                    in.read(chunk.data(), chunkSize);
+                    local.readMs += msSince(readStarted);
+
+                    size_t got = static_cast<size_t>(in.gcount());
+                    if (got == 0) break;
+                    chunk.resize(got);
+                    local.bytes += got;
+                    if (!chunks.push(chunk, cancelled)) break;
+                }
+            }
+            catch (...)
+            {
+                readError = std::current_exception();
+                cancelled = true;
+            }
+            chunks.close();
+        });
+
+    std::thread parser(
+        [&]()
+        {
+            try
+            {
+                StreamingParser<T> streaming(interner.get(), options.keepBinaryTree);
+                std::vector<T> batch;
+                batch.reserve(batchSize);
+
+                auto emit = [&](T value)
+                {
+                    batch.push_back(value);
+                    if (batch.size() < batchSize) return;
+                    batches.push(batch, cancelled);
+                    if (!freeBatches.tryPop(batch)) batch = std::vector<T>();
+                    batch.clear();
+                    batch.reserve(batchSize);
+                };
+
+                std::string chunk;
+                while (chunks.pop(chunk))
+                {
+                    auto parseStarted = Clock::now();
+                    streaming.feed(chunk.data(), chunk.size(), emit);
+                    local.parseMs += msSince(parseStarted);
+
+                    freeChunks.tryPush(chunk);
+                    if (streaming.failed() || cancelled.load(std::memory_order_relaxed))
+                    {
+                        cancelled = true;
+                        break;
+                    }
+                }
+                if (!batch.empty()) batches.push(batch, cancelled);
+                batches.close();
+
+                root = streaming.finish();
+            }
+            catch (...)
+            {
+                parseError = std::current_exception();
+                cancelled = true;
+            }
+            batches.close();
+        });
+
+    try
+    {
+        std::vector<T> batch;
+        RBTreeBuilder<T, RBTreeType> builder(*trees->rbTree);
+        while (batches.pop(batch))
+        {
+            auto buildStarted = Clock::now();
+            for (const T& value : batch) builder.add(value);
+            local.buildMs += msSince(buildStarted);
+            local.nodes += batch.size();
+            freeBatches.tryPush(batch);
+        }
+        auto buildStarted = Clock::now();
+        builder.finish();
+        local.buildMs += msSince(buildStarted);
+    }
+    catch (...)
+    {
+        cancelled = true;
+        reader.join();
+        parser.join();
+        throw;
+    }
+
+    reader.join();
+    parser.join();
+
+    if (readError) std::rethrow_exception(readError);
+    if (parseError) std::rethrow_exception(parseError);
+
+    trees->binaryTree = std::make_unique<BinaryTree<T>>();
+    if (interner)
+    {
+        trees->binaryTree->setRoot(root, std::move(interner));
+    }
+    else
+    {
+        trees->binaryTree->setRoot(root);
+    }
+
+    local.totalMs = msSince(started);
+    if (stats) *stats = local;
+    return trees;
+}
+
+template <typename T>
+std::shared_ptr<TreeSet<T>> loadTreeSet(const std::string& file, const LoadOptions& options = {},
+                                        PipelineStats* stats = nullptr)
+{
+    return loadTreeSetPipelined<T>(file, options, stats);
+}
+
+#endif
\ No newline at end of file
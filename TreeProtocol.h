@@ -0,0 +1,105 @@
+#ifndef TREEPROTOCOL_H
+#define TREEPROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Binary protocol spoken by TreeServer and tree_client over a Unix domain socket.
+// Both ends run on the same host, so integers travel in host byte order.
+//
+// A request is always 13 bytes: id (u32), opcode (u8), a (i32), b (i32). A client
+// may send any number of requests without waiting; the responses on one connection
+// come back in request order. A response is id (u32), status (u8), payload length
+// (u32) and the payload:
+//     Ping    nothing
+//     Search  count of a (u32), 0 if absent
+//     Insert  count of a after the insert (u32)
+//     Remove  count of a after the remove (u32)
+//     Range   count (u64), sum (i64), min (i32), max (i32) of the keys in [a, b]
+//     Scan    n (u32), then the first n distinct keys >= a (i32 each), n <= b
+//     Size    distinct keys (u64), total keys (u64)
+enum class TreeOp : uint8_t
+{
+    Ping = 0,
+    Search = 1,
+    Insert = 2,
+    Remove = 3,
+    Range = 4,
+    Scan = 5,
+    Size = 6
+};
+
+enum class TreeStatus : uint8_t
+{
+    Ok = 0,
+    NoTree = 1,
+    BadRequest = 2
+};
+
+struct TreeRequest
+{
+    static constexpr size_t wireSize = 13;
+    static constexpr uint32_t maxScan = 65536;
+
+    uint32_t id;
+    TreeOp op;
+    int32_t a;
+    int32_t b;
+
+    void encode(char* out) const
+    {
+        std::memcpy(out, &id, 4);
+        out[4] = static_cast<char>(op);
+        std::memcpy(out + 5, &a, 4);
+        std::memcpy(out + 9, &b, 4);
+    }
+
+    static TreeRequest decode(const char* in)
+    {
+        TreeRequest request;
+        std::memcpy(&request.id, in, 4);
+        request.op = static_cast<TreeOp>(static_cast<uint8_t>(in[4]));
+        std::memcpy(&request.a, in + 5, 4);
+        std::memcpy(&request.b, in + 9, 4);
+        return request;
+    }
+};
+
+constexpr size_t treeResponseHeaderSize = 9;
+
+template <typename N>
+void putWire(std::string& out, N value)
+{
+    char bytes[sizeof(N)];
+    std::memcpy(bytes, &value, sizeof(N));
+    out.append(bytes, sizeof(N));
+}
+
+template <typename N>
+N getWire(const char* in)
+{
+    N value;
+    std::memcpy(&value, in, sizeof(N));
+    return value;
+}
+
+// Appends a response header and returns where its payload length goes;
+// finishResponse fills the length in once the payload is written.
+inline size_t beginResponse(std::string& out, uint32_t id, TreeStatus status)
+{
+    putWire(out, id);
+    out.push_back(static_cast<char>(status));
+    size_t lengthAt = out.size();
+    putWire<uint32_t>(out, 0);
+    return lengthAt;
+}
+
+inline void finishResponse(std::string& out, size_t lengthAt)
+{
+    uint32_t length = static_cast<uint32_t>(out.size() - lengthAt - 4);
+    std::memcpy(out.data() + lengthAt, &length, 4);
+}
+
+#endif
@@ -0,0 +1,468 @@
+#ifndef TREESERVER_H
+#define TREESERVER_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "ThreadPool.h"
+#include "TreeLoader.h"
+#include "TreeProtocol.h"
+
+// Serves the trees returned by the snapshot callback over a Unix domain socket,
+// using the protocol in TreeProtocol.h. One thread runs the epoll loop and owns
+// the sockets; whole batches of pipelined requests go to a ThreadPool, with at
+// most one batch per connection in flight so responses keep request order.
+// Lookups hold TreeSet::mutex shared, inserts and removes hold it exclusively.
+class TreeServer
+{
+   private:
+    using Snapshot = std::function<std::shared_ptr<TreeSet<int>>()>;
+
+    struct Connection
+    {
+        int fd;
+        std::string input;
+        std::string output;
+        std::string batch;
+        std::string responses;
+        bool busy = false;
+        bool finished = false;
+        bool broken = false;
+        bool registered = true;
+        uint32_t events = 0;
+    };
+
+    static constexpr size_t maxBuffered = 1 << 22;
+
+    std::string path;
+    Snapshot snapshot;
+    int listenFd;
+    int epollFd;
+    int wakeFd;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> served;
+    std::map<int, std::shared_ptr<Connection>> connections;
+    std::mutex completedMutex;
+    std::vector<std::shared_ptr<Connection>> completed;
+    ThreadPool pool;
+
+    static void execute(const std::shared_ptr<TreeSet<int>>& trees, const TreeRequest& request,
+                        std::string& out)
+    {
+        if (request.op == TreeOp::Ping)
+        {
+            finishResponse(out, beginResponse(out, request.id, TreeStatus::Ok));
+            return;
+        }
+        if (!trees || !trees->rbTree)
+        {
+            finishResponse(out, beginResponse(out, request.id, TreeStatus::NoTree));
+            return;
+        }
+
+        TreeSet<int>::RBTreeType& tree = *trees->rbTree;
+        switch (request.op)
+        {
+            case TreeOp::Search:
+            {
+                std::shared_lock<std::shared_mutex> lock(trees->mutex);
+                size_t lengthAt = beginResponse(out, request.id, TreeStatus::Ok);
+                putWire(out, static_cast<uint32_t>(tree.count(request.a)));
+                finishResponse(out, lengthAt);
+                return;
+            }
+
+            case TreeOp::Insert:
+            case TreeOp::Remove:
+            {
+                std::unique_lock<std::shared_mutex> lock(trees->mutex);
+                if (request.op == TreeOp::Insert)
+                {
+                    tree.insert(request.a);
+                }
+                else
+                {
+                    tree.remove(request.a);
+                }
+                size_t lengthAt = beginResponse(out, request.id, TreeStatus::Ok);
+                putWire(out, static_cast<uint32_t>(tree.count(request.a)));
+                finishResponse(out, lengthAt);
+                return;
+            }
+
+            case TreeOp::Range:
+            {
+                if (request.b < request.a) break;
+                std::shared_lock<std::shared_mutex> lock(trees->mutex);
+                RangeSummary<int>::value_type summary = tree.rangeQuery(request.a, request.b);
+                size_t lengthAt = beginResponse(out, request.id, TreeStatus::Ok);
+                putWire(out, static_cast<uint64_t>(summary.count));
+                putWire(out, static_cast<int64_t>(summary.sum));
+                putWire(out, static_cast<int32_t>(summary.min));
+                putWire(out, static_cast<int32_t>(summary.max));
+                finishResponse(out, lengthAt);
+                return;
+            }
+
+            case TreeOp::Scan:
+            {
+                if (request.b < 0 || static_cast<uint32_t>(request.b) > TreeRequest::maxScan) break;
+                std::shared_lock<std::shared_mutex> lock(trees->mutex);
+                size_t lengthAt = beginResponse(out, request.id, TreeStatus::Ok);
+                size_t countAt = out.size();
+                putWire<uint32_t>(out, 0);
+                uint32_t written = 0;
+                for (auto it = tree.lowerBound(request.a);
+                     it != tree.end() && written < static_cast<uint32_t>(request.b); ++it)
+                {
+                    putWire(out, static_cast<int32_t>(*it));
+                    written++;
+                }
+                std::memcpy(out.data() + countAt, &written, 4);
+                finishResponse(out, lengthAt);
+                return;
+            }
+
+            case TreeOp::Size:
+            {
+                std::shared_lock<std::shared_mutex> lock(trees->mutex);
+                size_t lengthAt = beginResponse(out, request.id, TreeStatus::Ok);
+                putWire(out, static_cast<uint64_t>(tree.size()));
+                putWire(out, static_cast<uint64_t>(tree.totalCount()));
+                finishResponse(out, lengthAt);
+                return;
+            }
+
+            default:
+                break;
+        }
+        finishResponse(out, beginResponse(out, request.id, TreeStatus::BadRequest));
+    }
+
+#ifdef __linux__
+    // A connection is polled only for what it can act on; one with nothing to read
+    // or write is taken out of the epoll set so a hung-up peer cannot spin the loop.
+    void watch(Connection& connection)
+    {
+        uint32_t events = 0;
+        if (!connection.finished && connection.input.size() < maxBuffered) events |= EPOLLIN;
+        if (!connection.output.empty()) events |= EPOLLOUT;
+
+        if (events == 0)
+        {
+            if (connection.registered) epoll_ctl(epollFd, EPOLL_CTL_DEL, connection.fd, nullptr);
+            connection.registered = false;
+            return;
+        }
+        if (connection.registered && events == connection.events) return;
+
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = connection.fd;
+        epoll_ctl(epollFd, connection.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, connection.fd,
+                  &event);
+        connection.registered = true;
+        connection.events = events;
+    }
+
+    void closeConnection(const std::shared_ptr<Connection>& connection)
+    {
+        if (connection->registered) epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->fd, nullptr);
+        close(connection->fd);
+        connections.erase(connection->fd);
+    }
+
+    // Dispatches the next batch, or closes the connection once the peer has stopped
+    // sending and every response has been written.
+    void advance(const std::shared_ptr<Connection>& connection)
+    {
+        if (connection->broken && !connection->busy)
+        {
+            closeConnection(connection);
+            return;
+        }
+        if (!connection->broken) dispatch(connection);
+        if (connection->finished && !connection->busy && connection->output.empty())
+        {
+            closeConnection(connection);
+            return;
+        }
+        if (connection->broken)
+        {
+            connection->finished = true;
+            connection->output.clear();
+        }
+        watch(*connection);
+    }
+
+    void dispatch(const std::shared_ptr<Connection>& connection)
+    {
+        size_t whole = connection->input.size() / TreeRequest::wireSize * TreeRequest::wireSize;
+        if (connection->busy || whole == 0 || connection->output.size() >= maxBuffered) return;
+
+        connection->batch.assign(connection->input, 0, whole);
+        connection->input.erase(0, whole);
+        connection->busy = true;
+
+        pool.submit(
+            [this, connection]()
+            {
+                std::shared_ptr<TreeSet<int>> trees = snapshot();
+                const std::string& batch = connection->batch;
+                connection->responses.clear();
+                for (size_t at = 0; at < batch.size(); at += TreeRequest::wireSize)
+                {
+                    execute(trees, TreeRequest::decode(batch.data() + at), connection->responses);
+                }
+                served.fetch_add(batch.size() / TreeRequest::wireSize, std::memory_order_relaxed);
+
+                {
+                    std::lock_guard<std::mutex> lock(completedMutex);
+                    completed.push_back(connection);
+                }
+                uint64_t one = 1;
+                [[maybe_unused]] ssize_t written = write(wakeFd, &one, sizeof(one));
+            });
+    }
+
+    // Returns false when the peer is gone.
+    bool flush(Connection& connection)
+    {
+        size_t sent = 0;
+        while (sent < connection.output.size())
+        {
+            ssize_t n = send(connection.fd, connection.output.data() + sent,
+                             connection.output.size() - sent, MSG_NOSIGNAL);
+            if (n > 0)
+            {
+                sent += static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            return false;
+        }
+        connection.output.erase(0, sent);
+        return true;
+    }
+
+    // Returns false on end of stream or error.
+    bool receive(Connection& connection)
+    {
+        char buffer[65536];
+        while (connection.input.size() < maxBuffered)
+        {
+            ssize_t n = recv(connection.fd, buffer, sizeof(buffer), 0);
+            if (n > 0)
+            {
+                connection.input.append(buffer, static_cast<size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+            return false;
+        }
+        return true;
+    }
+
+    void acceptAll()
+    {
+        while (true)
+        {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+
+            auto connection = std::make_shared<Connection>();
+            connection->fd = fd;
+            connection->events = EPOLLIN;
+
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+            {
+                close(fd);
+                continue;
+            }
+            connections[fd] = connection;
+        }
+    }
+
+    void finishBatches()
+    {
+        uint64_t count;
+        [[maybe_unused]] ssize_t got = read(wakeFd, &count, sizeof(count));
+
+        std::vector<std::shared_ptr<Connection>> done;
+        {
+            std::lock_guard<std::mutex> lock(completedMutex);
+            done.swap(completed);
+        }
+
+        for (const std::shared_ptr<Connection>& connection : done)
+        {
+            connection->busy = false;
+            if (!connection->broken)
+            {
+                connection->output += connection->responses;
+                if (!flush(*connection)) connection->broken = true;
+            }
+            advance(connection);
+        }
+    }
+
+    void handle(int fd, uint32_t events)
+    {
+        auto found = connections.find(fd);
+        if (found == connections.end()) return;
+        std::shared_ptr<Connection> connection = found->second;
+
+        if ((events & EPOLLOUT) && !flush(*connection)) connection->broken = true;
+        if (!connection->broken && !connection->finished &&
+            (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !receive(*connection))
+        {
+            connection->finished = true;
+        }
+        advance(connection);
+    }
+#endif
+
+   public:
+    TreeServer(const std::string& socketPath, Snapshot trees, size_t threadCount)
+        : path(socketPath),
+          snapshot(std::move(trees)),
+          listenFd(-1),
+          epollFd(-1),
+          wakeFd(-1),
+          running(false),
+          served(0),
+          pool(threadCount)
+    {
+    }
+
+    ~TreeServer()
+    {
+#ifdef __linux__
+        pool.wait();
+        for (auto& entry : connections) close(entry.first);
+        if (listenFd >= 0)
+        {
+            close(listenFd);
+            unlink(path.c_str());
+        }
+        if (epollFd >= 0) close(epollFd);
+        if (wakeFd >= 0) close(wakeFd);
+#endif
+    }
+
+    TreeServer(const TreeServer&) = delete;
+    TreeServer& operator=(const TreeServer&) = delete;
+
+    void start()
+    {
+#ifdef __linux__
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            throw std::runtime_error("Socket path is too long: " + path);
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0)
+        {
+            throw std::runtime_error("Cannot create socket");
+        }
+        unlink(path.c_str());
+        if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+            listen(listenFd, 128) < 0)
+        {
+            close(listenFd);
+            listenFd = -1;
+            throw std::runtime_error("Cannot listen on " + path);
+        }
+
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epollFd < 0 || wakeFd < 0)
+        {
+            throw std::runtime_error("Cannot create epoll instance");
+        }
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = listenFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+        event.data.fd = wakeFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+        running = true;
+#else
+        throw std::runtime_error("The server is only supported on Linux");
+#endif
+    }
+
+    // Runs the event loop on the calling thread until stop() is called.
+    void run()
+    {
+#ifdef __linux__
+        epoll_event events[128];
+        while (running)
+        {
+            int ready = epoll_wait(epollFd, events, 128, -1);
+            for (int i = 0; i < ready; i++)
+            {
+                int fd = events[i].data.fd;
+                if (fd == listenFd)
+                {
+                    acceptAll();
+                }
+                else if (fd == wakeFd)
+                {
+                    finishBatches();
+                }
+                else
+                {
+                    handle(fd, events[i].events);
+                }
+            }
+        }
+#endif
+    }
+
+    // Safe to call from a signal handler.
+    void stop()
+    {
+#ifdef __linux__
+        running = false;
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = write(wakeFd, &one, sizeof(one));
+#endif
+    }
+
+    uint64_t requestsServed() const { return served.load(std::memory_order_relaxed); }
+
+    size_t threadCount() const { return pool.size(); }
+
+    const std::string& getPath() const { return path; }
+};
+
+#endif
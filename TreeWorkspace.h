@@ -0,0 +1,128 @@
+#ifndef TREEWORKSPACE_H
+#define TREEWORKSPACE_H
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "TreeLoader.h"
+
+struct LoadReport
+{
+    std::string name;
+    std::string file;
+    bool ok;
+    std::string error;
+    size_t bytes;
+    double readMs;
+    double buildMs;
+};
+
+template <typename T>
+class TreeWorkspace
+{
+   private:
+    std::map<std::string, std::shared_ptr<TreeSet<T>>> trees;
+    mutable std::mutex mutex;
+
+    static double millisecondsSince(std::chrono::steady_clock::time_point started)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                         started)
+            .count();
+    }
+
+    static void loadOne(LoadReport& report, const LoadOptions& options,
+                        std::shared_ptr<TreeSet<T>>& result)
+    {
+        try
+        {
+            auto started = std::chrono::steady_clock::now();
+            std::string content = readFile(report.file);
+            report.bytes = content.size();
+            report.readMs = millisecondsSince(started);
+
+            started = std::chrono::steady_clock::now();
+            result = buildTreeSet<T>(content, report.file, options);
+            report.buildMs = millisecondsSince(started);
+            report.ok = true;
+        }
+        catch (const std::exception& e)
+        {
+            report.error = e.what();
+        }
+    }
+
+   public:
+    // Trees are named by file stem. A file whose stem was already taken by an
+    // earlier file in sorted order is reported as an error and not loaded.
+    std::vector<LoadReport> loadDirectory(const std::string& directory, size_t threadCount,
+                                          const LoadOptions& options = {})
+    {
+        namespace fs = std::filesystem;
+
+        if (!fs::is_directory(directory))
+        {
+            throw std::runtime_error("Not a directory: " + directory);
+        }
+
+        std::vector<fs::path> files;
+        for (const fs::directory_entry& entry : fs::directory_iterator(directory))
+        {
+            if (entry.is_regular_file()) files.push_back(entry.path());
+        }
+        std::sort(files.begin(), files.end());
+
+        std::vector<LoadReport> reports(files.size());
+        std::vector<std::shared_ptr<TreeSet<T>>> results(files.size());
+        std::map<std::string, std::string> claimed;
+        {
+            ThreadPool pool(std::min(threadCount, std::max<size_t>(files.size(), 1)));
+            for (size_t i = 0; i < files.size(); i++)
+            {
+                reports[i] = {files[i].stem().string(), files[i].string(), false, "", 0, 0, 0};
+                auto [owner, added] = claimed.emplace(reports[i].name, reports[i].file);
+                if (!added)
+                {
+                    reports[i].error = "Tree name " + reports[i].name + " already used by " +
+                                       owner->second;
+                    continue;
+                }
+                pool.submit([&reports, &results, &options, i]()
+                            { loadOne(reports[i], options, results[i]); });
+            }
+            pool.wait();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            if (results[i]) trees[reports[i].name] = results[i];
+        }
+        return reports;
+    }
+
+    std::shared_ptr<TreeSet<T>> get(const std::string& name) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = trees.find(name);
+        return it == trees.end() ? nullptr : it->second;
+    }
+
+    std::vector<std::string> names() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::string> result;
+        for (const auto& entry : trees) result.push_back(entry.first);
+        return result;
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,725 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <compare>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BinaryTree.h"
+#include "MemoryAccounting.h"
+#include "Parser.h"
+#include "RBTree.h"
+#include "ShardedRBTree.h"
+#include "StaticRBTree.h"
+#include "TreeExport.h"
+#include "TreeLoader.h"
+
+class Stopwatch
+{
+   private:
+    std::chrono::steady_clock::time_point started;
+
+   public:
+    Stopwatch() : started(std::chrono::steady_clock::now()) {}
+
+    double seconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    }
+};
+
+void printRate(const std::string& stage, double seconds, double bytes, double nodes)
+{
+    std::cout << std::left << std::setw(10) << stage << std::right << std::fixed
+              << std::setprecision(3) << std::setw(10) << seconds * 1000 << " ms";
+    if (bytes > 0)
+    {
+        std::cout << std::setw(12) << std::setprecision(1) << bytes / seconds / 1e6 << " MB/s";
+    }
+    if (nodes > 0)
+    {
+        std::cout << std::setw(14) << std::setprecision(0) << nodes / seconds << " nodes/s";
+    }
+    std::cout << "\n";
+}
+
+void benchmarkLoad(const std::string& filename, int repeats, bool shareSubtrees)
+{
+    for (int run = 1; run <= repeats; run++)
+    {
+        Stopwatch readTimer;
+        std::string content = readFile(filename);
+        double readSeconds = readTimer.seconds();
+
+        Stopwatch parseTimer;
+        LoadOptions options;
+        options.shareSubtrees = shareSubtrees;
+        std::unique_ptr<BinaryTree<int>> binaryTree = parseBinaryTree<int>(content, options);
+        double parseSeconds = parseTimer.seconds();
+
+        size_t nodes = 0;
+        Stopwatch buildTimer;
+        RBTree<int> rbTree;
+        binaryTree->traverse(
+            [&rbTree, &nodes](int val)
+            {
+                rbTree.insert(val);
+                nodes++;
+            });
+        double buildSeconds = buildTimer.seconds();
+
+        double bytes = static_cast<double>(content.size());
+        std::cout << "\nRun " << run << ": " << filename << " (" << content.size() << " bytes, "
+                  << nodes << " nodes)\n";
+        if (shareSubtrees)
+        {
+            std::cout << "shared subtrees: " << binaryTree->storedNodeCount() << " nodes stored\n";
+        }
+        printRate("read", readSeconds, bytes, 0);
+        printRate("parse", parseSeconds, bytes, nodes);
+        printRate("rb-build", buildSeconds, 0, nodes);
+        printRate("total", readSeconds + parseSeconds + buildSeconds, bytes, nodes);
+    }
+}
+
+void benchmarkPipeline(const std::string& filename, int repeats, bool rbOnly)
+{
+    LoadOptions options;
+    options.keepBinaryTree = !rbOnly;
+
+    for (int run = 1; run <= repeats; run++)
+    {
+        Stopwatch sequentialTimer;
+        std::shared_ptr<TreeSet<int>> sequential =
+            buildTreeSet<int>(readFile(filename), filename, options);
+        double sequentialSeconds = sequentialTimer.seconds();
+        sequential.reset();
+
+        PipelineStats stats;
+        loadTreeSetPipelined<int>(filename, options, &stats);
+
+        double bytes = static_cast<double>(stats.bytes);
+        double nodes = static_cast<double>(stats.nodes);
+        std::cout << "\nRun " << run << ": " << filename << " (" << stats.bytes << " bytes, "
+                  << stats.nodes << " nodes)\n";
+        printRate("sequential", sequentialSeconds, bytes, nodes);
+        printRate("pipelined", stats.totalMs / 1000, bytes, nodes);
+        std::cout << "busy time per stage:\n";
+        printRate("  read", stats.readMs / 1000, bytes, 0);
+        printRate("  parse", stats.parseMs / 1000, bytes, nodes);
+        printRate("  build", stats.buildMs / 1000, 0, nodes);
+    }
+}
+
+void benchmarkExport(const std::string& filename, const std::string& formatName,
+                     const std::string& output)
+{
+    ExportFormat format = parseExportFormat(formatName);
+    std::shared_ptr<TreeSet<int>> trees = loadTreeSet<int>(filename);
+
+    Stopwatch binaryTimer;
+    ExportResult binary = exportBinaryTree(*trees->binaryTree, output, format);
+    double binarySeconds = binaryTimer.seconds();
+
+    Stopwatch rbTimer;
+    ExportResult rb = exportRBTree(*trees->rbTree, output, format);
+    double rbSeconds = rbTimer.seconds();
+
+    std::cout << "\n" << filename << " as " << formatName << "\n";
+    printRate("binary", binarySeconds, static_cast<double>(binary.bytes),
+              static_cast<double>(binary.nodes));
+    printRate("rb", rbSeconds, static_cast<double>(rb.bytes), static_cast<double>(rb.nodes));
+}
+
+constexpr size_t staticKeyCount = 4096;
+
+constexpr std::array<int, staticKeyCount> staticKeys()
+{
+    std::array<int, staticKeyCount> keys{};
+    for (size_t i = 0; i < staticKeyCount; i++)
+    {
+        keys[i] = static_cast<int>((i * 7919) % 1000003);
+    }
+    return keys;
+}
+
+constexpr auto staticSet = makeStaticRBTree(staticKeys());
+static_assert(staticSet.size() == staticKeyCount && staticSet.isValid());
+
+constexpr auto staticLiteral = parseStaticRBTree<int, "(50 (20 (10) (30)) (70 (60) (80 (90))))">();
+static_assert(staticLiteral.size() == 8 && staticLiteral.search(90) && !staticLiteral.search(40));
+
+void benchmarkStatic(size_t lookups)
+{
+    Stopwatch buildTimer;
+    RBTree<int> runtimeSet;
+    for (int key : staticKeys()) runtimeSet.insert(key);
+    double buildSeconds = buildTimer.seconds();
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> dist(0, 1000003);
+    std::vector<int> probes(lookups);
+    for (int& probe : probes) probe = dist(rng);
+
+    size_t runtimeHits = 0;
+    Stopwatch runtimeTimer;
+    for (int probe : probes) runtimeHits += runtimeSet.search(probe);
+    double runtimeSeconds = runtimeTimer.seconds();
+
+    size_t staticHits = 0;
+    Stopwatch staticTimer;
+    for (int probe : probes) staticHits += staticSet.search(probe);
+    double staticSeconds = staticTimer.seconds();
+
+    if (runtimeHits != staticHits)
+    {
+        throw std::runtime_error("Static and runtime sets disagree");
+    }
+
+    std::cout << "\n" << staticKeyCount << " keys, " << lookups << " lookups, " << staticHits
+              << " hits\n";
+    printRate("build", buildSeconds, 0, staticKeyCount);
+    printRate("rbtree", runtimeSeconds, 0, static_cast<double>(lookups));
+    printRate("static", staticSeconds, 0, static_cast<double>(lookups));
+}
+
+// Counts key comparisons. LessThanCompare orders with operator< only, the way
+// RBTree did before it took a Compare parameter: one call to go left, a second to
+// go right or to find a match.
+struct CountingCompare
+{
+    size_t* calls;
+
+    std::strong_ordering operator()(const std::string& a, const std::string& b) const
+    {
+        ++*calls;
+        return a <=> b;
+    }
+};
+
+struct LessThanCompare
+{
+    size_t* calls;
+
+    std::weak_ordering operator()(const std::string& a, const std::string& b) const
+    {
+        ++*calls;
+        if (a < b) return std::weak_ordering::less;
+        ++*calls;
+        if (b < a) return std::weak_ordering::greater;
+        return std::weak_ordering::equivalent;
+    }
+};
+
+template <typename Compare>
+void benchmarkStringCompare(const std::string& name, const std::vector<std::string>& keys,
+                            const std::vector<std::string>& probes)
+{
+    size_t calls = 0;
+    RBTree<std::string, NoAggregate<std::string>, Compare> tree(false, Compare{&calls});
+
+    Stopwatch insertTimer;
+    for (const std::string& key : keys) tree.insert(key);
+    double insertSeconds = insertTimer.seconds();
+    size_t insertCalls = calls;
+
+    calls = 0;
+    size_t hits = 0;
+    Stopwatch searchTimer;
+    for (const std::string& probe : probes) hits += tree.search(probe);
+    double searchSeconds = searchTimer.seconds();
+
+    std::cout << name << " (" << hits << " hits)\n";
+    printRate("  insert", insertSeconds, 0, static_cast<double>(keys.size()));
+    std::cout << "            " << std::setprecision(2)
+              << static_cast<double>(insertCalls) / keys.size() << " comparisons per insert\n";
+    printRate("  search", searchSeconds, 0, static_cast<double>(probes.size()));
+    std::cout << "            " << std::setprecision(2)
+              << static_cast<double>(calls) / probes.size() << " comparisons per search\n";
+}
+
+void benchmarkStrings(size_t keyCount)
+{
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> dist(0, static_cast<int>(keyCount) * 2);
+    auto makeKey = [&rng, &dist]()
+    { return "tenant/eu-west/bucket-000042/object-" + std::to_string(dist(rng)); };
+
+    std::vector<std::string> keys(keyCount);
+    for (std::string& key : keys) key = makeKey();
+    std::vector<std::string> probes(keyCount);
+    for (std::string& probe : probes) probe = makeKey();
+
+    std::cout << "\n" << keyCount << " std::string keys with a 36-byte shared prefix\n";
+    benchmarkStringCompare<LessThanCompare>("operator< twice", keys, probes);
+    benchmarkStringCompare<CountingCompare>("three-way", keys, probes);
+}
+
+std::vector<int> randomKeys(size_t count, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(0, 1000000000);
+    std::vector<int> keys(count);
+    for (int& key : keys) key = dist(rng);
+    return keys;
+}
+
+// Builds one RBTree per insertion strategy from the same key stream and checks
+// that they end up with the same contents.
+void benchmarkSortedInserts(size_t keyCount, size_t swaps)
+{
+    std::mt19937 rng(13);
+    std::vector<int> keys(keyCount);
+    for (size_t i = 0; i < keyCount; i++) keys[i] = static_cast<int>(i);
+    std::uniform_int_distribution<size_t> position(0, keyCount > 1 ? keyCount - 2 : 0);
+    for (size_t i = 0; i < swaps && keyCount > 1; i++)
+    {
+        size_t at = position(rng);
+        std::swap(keys[at], keys[at + 1]);
+    }
+
+    Stopwatch rootTimer;
+    RBTree<int, RangeSummary<int>> fromRoot;
+    for (int key : keys) fromRoot.insert(key);
+    double rootSeconds = rootTimer.seconds();
+
+    Stopwatch fingerTimer;
+    RBTree<int, RangeSummary<int>> fromFinger;
+    fromFinger.setFingerInsertion(true);
+    fromFinger.beginBulkLoad();
+    for (int key : keys) fromFinger.insert(key);
+    fromFinger.endBulkLoad();
+    double fingerSeconds = fingerTimer.seconds();
+
+    Stopwatch hintTimer;
+    RBTree<int, RangeSummary<int>> fromHint;
+    for (int key : keys) fromHint.insert(fromHint.end(), key);
+    double hintSeconds = hintTimer.seconds();
+
+    if (fromFinger.aggregate().sum != fromRoot.aggregate().sum ||
+        fromHint.size() != fromRoot.size() || fromFinger.size() != fromRoot.size())
+    {
+        throw std::runtime_error("Insertion strategies disagree");
+    }
+
+    std::cout << "\n" << keyCount << " keys, " << swaps << " adjacent swaps\n";
+    printRate("root", rootSeconds, 0, static_cast<double>(keyCount));
+    printRate("finger", fingerSeconds, 0, static_cast<double>(keyCount));
+    printRate("hint end", hintSeconds, 0, static_cast<double>(keyCount));
+}
+
+// Draws ranks in [0, n) with probability proportional to 1 / (rank + 1)^skew by
+// inverting a precomputed CDF.
+class ZipfDistribution
+{
+   private:
+    std::vector<double> cdf;
+
+   public:
+    ZipfDistribution(size_t n, double skew) : cdf(n)
+    {
+        double total = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            total += 1.0 / std::pow(static_cast<double>(i + 1), skew);
+            cdf[i] = total;
+        }
+        for (double& value : cdf) value /= total;
+    }
+
+    template <typename Rng>
+    size_t operator()(Rng& rng)
+    {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        size_t rank = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+        return std::min(rank, cdf.size() - 1);
+    }
+};
+
+// Zipf-skewed lookups, half of them for absent keys, with and without the
+// lookup cache in front of the same tree.
+void benchmarkZipf(size_t keyCount, size_t lookups, double skew, size_t slots)
+{
+    // Present keys are even and absent ones odd, so misses end all over the tree
+    std::vector<int> keys = randomKeys(keyCount, 21);
+    RBTree<int> tree;
+    for (int key : keys) tree.insert(key * 2);
+
+    // Ranks are shuffled so hot keys are scattered over the tree, not bunched
+    std::mt19937 rng(5);
+    std::vector<int> byRank(keys);
+    std::shuffle(byRank.begin(), byRank.end(), rng);
+    ZipfDistribution zipf(keyCount, skew);
+    std::vector<int> probes(lookups);
+    for (int& probe : probes)
+    {
+        int key = byRank[zipf(rng)];
+        probe = key * 2 + static_cast<int>(rng() % 2);
+    }
+
+    size_t plainHits = 0;
+    Stopwatch plainTimer;
+    for (int probe : probes) plainHits += tree.search(probe);
+    double plainSeconds = plainTimer.seconds();
+
+    tree.enableLookupCache(slots);
+    size_t cachedHits = 0;
+    Stopwatch cachedTimer;
+    for (int probe : probes) cachedHits += tree.search(probe);
+    double cachedSeconds = cachedTimer.seconds();
+
+    if (plainHits != cachedHits)
+    {
+        throw std::runtime_error("Cached and uncached searches disagree");
+    }
+
+    LookupCacheStats stats = tree.lookupCacheStats();
+    std::cout << "\n" << tree.size() << " keys, " << lookups << " lookups, zipf " << skew
+              << ", " << stats.slots << " cache slots\n";
+    printRate("search", plainSeconds, 0, static_cast<double>(lookups));
+    printRate("cached", cachedSeconds, 0, static_cast<double>(lookups));
+    std::cout << "hit rate " << std::fixed << std::setprecision(1) << stats.hitRate() * 100
+              << "%\n";
+}
+
+// Uniform lookups where the given share of keys is absent, with and without the
+// membership filter in front of the same tree.
+void benchmarkFilter(size_t keyCount, size_t lookups, double falsePositiveRate, int absentPercent)
+{
+    std::vector<int> keys = randomKeys(keyCount, 23);
+    RBTree<int> tree;
+    for (int key : keys) tree.insert(key * 2);
+
+    std::mt19937 rng(6);
+    std::uniform_int_distribution<size_t> pick(0, keys.size() - 1);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::vector<int> probes(lookups);
+    for (int& probe : probes)
+    {
+        int key = keys[pick(rng)];
+        probe = key * 2 + (percent(rng) < absentPercent ? 1 : 0);
+    }
+
+    size_t plainHits = 0;
+    Stopwatch plainTimer;
+    for (int probe : probes) plainHits += tree.search(probe);
+    double plainSeconds = plainTimer.seconds();
+
+    Stopwatch buildTimer;
+    tree.enableMembershipFilter(falsePositiveRate);
+    double buildSeconds = buildTimer.seconds();
+
+    size_t filteredHits = 0;
+    Stopwatch filteredTimer;
+    for (int probe : probes) filteredHits += tree.search(probe);
+    double filteredSeconds = filteredTimer.seconds();
+
+    if (plainHits != filteredHits)
+    {
+        throw std::runtime_error("Filtered and unfiltered searches disagree");
+    }
+
+    MembershipFilterStats stats = tree.membershipFilterStats();
+    std::cout << "\n" << tree.size() << " keys, " << lookups << " lookups, " << absentPercent
+              << "% absent, filter of " << stats.bytes() << " B with " << stats.hashes
+              << " hashes\n";
+    printRate("build", buildSeconds, 0, static_cast<double>(tree.size()));
+    printRate("search", plainSeconds, 0, static_cast<double>(lookups));
+    printRate("filtered", filteredSeconds, 0, static_cast<double>(lookups));
+    std::cout << std::fixed << std::setprecision(3) << "false positives "
+              << stats.observedRate() * 100 << "% observed, " << stats.expectedRate * 100
+              << "% expected, " << stats.targetRate * 100 << "% target\n";
+}
+
+// "(0 (1 (2 ...)))": a tree file whose nodes each have one child, which the
+// parser turns into a left chain of the given depth.
+std::string chainContent(size_t depth)
+{
+    std::string content;
+    content.reserve(depth * 10);
+    for (size_t i = 0; i < depth; i++)
+    {
+        if (i > 0) content += ' ';
+        content += '(';
+        content += std::to_string(i);
+    }
+    content.append(depth, ')');
+    return content;
+}
+
+struct ChainTimes
+{
+    double parse;
+    double walk;
+    double build;
+    double rbWalk;
+    double free;
+};
+
+ChainTimes timeChain(size_t nodes)
+{
+    std::string content = chainContent(nodes);
+    TreeSet<int> trees;
+    ChainTimes times;
+
+    Stopwatch parseTimer;
+    trees.binaryTree = parseBinaryTree<int>(content);
+    times.parse = parseTimer.seconds();
+    std::string().swap(content);
+
+    size_t walked = 0;
+    Stopwatch walkTimer;
+    trees.binaryTree->traverse([&walked](int) { walked++; });
+    times.walk = walkTimer.seconds();
+
+    Stopwatch buildTimer;
+    buildRBTree(trees);
+    times.build = buildTimer.seconds();
+
+    size_t rbWalked = 0;
+    Stopwatch rbWalkTimer;
+    trees.rbTree->inorderTraversal([&rbWalked](int) { rbWalked++; });
+    times.rbWalk = rbWalkTimer.seconds();
+
+    Stopwatch freeTimer;
+    trees.binaryTree.reset();
+    trees.rbTree.reset();
+    times.free = freeTimer.seconds();
+
+    if (walked != nodes || rbWalked != nodes)
+    {
+        throw std::runtime_error("Chain walk lost nodes");
+    }
+    return times;
+}
+
+// Loads, walks and frees left chains of a quarter, half and all of depth. Every
+// stage is reported in ns per node, which stays flat when the stage is linear.
+// An unreported pass at full depth runs first, so that the measured passes reuse
+// memory the allocator already holds instead of timing the kernel's page faults.
+void benchmarkDeep(size_t depth)
+{
+    if (depth > 0) timeChain(depth);
+
+    std::cout << "\nLeft chains, ns per node\n"
+              << std::setw(12) << "depth" << std::setw(10) << "parse" << std::setw(10) << "walk"
+              << std::setw(10) << "rb-build" << std::setw(10) << "rb-walk" << std::setw(10)
+              << "free" << "\n";
+
+    for (size_t nodes : {depth / 4, depth / 2, depth})
+    {
+        if (nodes == 0) continue;
+
+        ChainTimes times = timeChain(nodes);
+        auto perNode = [nodes](double seconds) { return seconds * 1e9 / nodes; };
+        std::cout << std::setw(12) << nodes << std::fixed << std::setprecision(1)
+                  << std::setw(10) << perNode(times.parse) << std::setw(10)
+                  << perNode(times.walk) << std::setw(10) << perNode(times.build)
+                  << std::setw(10) << perNode(times.rbWalk) << std::setw(10)
+                  << perNode(times.free) << "\n";
+    }
+}
+
+template <typename Insert>
+double timeParallelInserts(const std::vector<int>& keys, size_t threadCount, Insert insert)
+{
+    std::vector<std::thread> writers;
+    Stopwatch timer;
+    for (size_t t = 0; t < threadCount; t++)
+    {
+        writers.emplace_back(
+            [&keys, &insert, t, threadCount]()
+            {
+                for (size_t i = t; i < keys.size(); i += threadCount) insert(keys[i]);
+            });
+    }
+    for (std::thread& writer : writers) writer.join();
+    return timer.seconds();
+}
+
+void benchmarkSharded(size_t keyCount, size_t maxThreads, size_t shardCount)
+{
+    std::vector<int> keys = randomKeys(keyCount, 42);
+    std::vector<int> sample(keys.begin(), keys.begin() + std::min<size_t>(keys.size(), 10000));
+
+    std::cout << "\n" << keyCount << " uniform keys, " << shardCount << " shards\n";
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        RBTree<int> single;
+        std::mutex singleMutex;
+        auto lockedInsert = [&single, &singleMutex](int key)
+        {
+            std::lock_guard<std::mutex> lock(singleMutex);
+            single.insert(key);
+        };
+        double singleSeconds = timeParallelInserts(keys, threads, lockedInsert);
+
+        ShardedRBTree<int> sharded(shardCount, sample);
+        double shardedSeconds =
+            timeParallelInserts(keys, threads, [&sharded](int key) { sharded.insert(key); });
+
+        std::cout << std::setw(3) << threads << " threads: single lock " << std::fixed
+                  << std::setprecision(2) << keyCount / singleSeconds / 1e6 << " Mops/s, sharded "
+                  << keyCount / shardedSeconds / 1e6 << " Mops/s (skew " << sharded.skew()
+                  << ")\n";
+    }
+}
+
+// Allocates and frees node-sized and cache-line-aligned blocks in batches of 1024
+// from each thread; run with and without TREE_MEMORY_ACCOUNTING to see what the
+// counting hook costs.
+void benchmarkAllocations(size_t count, size_t threadCount)
+{
+    struct alignas(64) Line
+    {
+        char bytes[64];
+    };
+
+    auto churn = [count, threadCount](auto make)
+    {
+        std::vector<std::thread> workers;
+        Stopwatch timer;
+        for (size_t t = 0; t < threadCount; t++)
+        {
+            workers.emplace_back(
+                [count, threadCount, make]()
+                {
+                    std::vector<decltype(make())> batch;
+                    batch.reserve(1024);
+                    for (size_t done = 0; done < count / threadCount; done += batch.size())
+                    {
+                        batch.clear();
+                        for (size_t i = 0; i < 1024; i++) batch.push_back(make());
+                        for (auto* block : batch) delete block;
+                    }
+                });
+        }
+        for (std::thread& worker : workers) worker.join();
+        return timer.seconds();
+    };
+
+    double nodeSeconds = churn([]() { return new BinaryTreeNode<int>(0); });
+    double lineSeconds = churn([]() { return new Line(); });
+
+    std::cout << "\n" << count << " allocations per kind, " << threadCount
+              << " threads, accounting " << (MemoryAccounting::isEnabled() ? "on" : "off")
+              << "\n";
+    std::cout << std::fixed << std::setprecision(1) << "node      "
+              << nodeSeconds * 1e9 / count << " ns per new/delete\n"
+              << "aligned   " << lineSeconds * 1e9 / count << " ns per new/delete\n";
+}
+
+void printUsage()
+{
+    std::cerr << "Usage: tree_bench <command> [arguments]\n"
+              << "  load <file> [repeats] [shared]\n"
+              << "                           time readFile, Parser::parse and the RBTree build;\n"
+              << "                           'shared' parses with identical subtrees interned\n"
+              << "  pipeline <file> [repeats] [rbonly]\n"
+              << "                           sequential load vs the reader/parser/builder\n"
+              << "                           pipeline; 'rbonly' parses straight into the RBTree\n"
+              << "  export <file> dot|json|csv <output>\n"
+              << "                           write throughput of the tree exporters\n"
+              << "  static [lookups]\n"
+              << "                           lookups in a constexpr StaticRBTree vs a heap RBTree\n"
+              << "  strings <keys>\n"
+              << "                           std::string inserts and lookups, <=> vs operator<\n"
+              << "  sorted <keys> [swaps]\n"
+              << "                           nearly sorted inserts from the root, the finger and\n"
+              << "                           an end() hint\n"
+              << "  zipf <keys> <lookups> [skew] [slots]\n"
+              << "                           Zipf searches with and without the lookup cache\n"
+              << "  filter <keys> <lookups> [false positive rate] [absent %]\n"
+              << "                           searches with and without the membership filter\n"
+              << "  deep <depth>\n"
+              << "                           parse, walk and free left chains up to <depth> nodes\n"
+              << "  alloc <count> [threads]\n"
+              << "                           cost of new/delete; run with and without\n"
+              << "                           TREE_MEMORY_ACCOUNTING=1 to compare\n"
+              << "  sharded <keys> <threads> <shards>\n"
+              << "                           insert rate of ShardedRBTree vs one locked RBTree\n";
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printUsage();
+        return 1;
+    }
+
+    try
+    {
+        std::string command = argv[1];
+        if (command == "load" && argc >= 3)
+        {
+            benchmarkLoad(argv[2], argc >= 4 ? std::stoi(argv[3]) : 1,
+                          argc >= 5 && std::string(argv[4]) == "shared");
+        }
+        else if (command == "pipeline" && argc >= 3)
+        {
+            benchmarkPipeline(argv[2], argc >= 4 ? std::stoi(argv[3]) : 1,
+                              argc >= 5 && std::string(argv[4]) == "rbonly");
+        }
+        else if (command == "export" && argc >= 5)
+        {
+            benchmarkExport(argv[2], argv[3], argv[4]);
+        }
+        else if (command == "static")
+        {
+            benchmarkStatic(argc >= 3 ? std::stoull(argv[2]) : 10000000);
+        }
+        else if (command == "strings" && argc >= 3)
+        {
+            benchmarkStrings(std::stoull(argv[2]));
+        }
+        else if (command == "sorted" && argc >= 3)
+        {
+            benchmarkSortedInserts(std::stoull(argv[2]), argc >= 4 ? std::stoull(argv[3]) : 0);
+        }
+        else if (command == "zipf" && argc >= 4)
+        {
+            benchmarkZipf(std::stoull(argv[2]), std::stoull(argv[3]),
+                          argc >= 5 ? std::stod(argv[4]) : 0.99,
+                          argc >= 6 ? std::stoull(argv[5]) : 65536);
+        }
+        else if (command == "filter" && argc >= 4)
+        {
+            benchmarkFilter(std::stoull(argv[2]), std::stoull(argv[3]),
+                            argc >= 5 ? std::stod(argv[4]) : 0.01,
+                            argc >= 6 ? std::clamp(std::stoi(argv[5]), 0, 100) : 60);
+        }
+        else if (command == "deep" && argc >= 3)
+        {
+            benchmarkDeep(std::stoull(argv[2]));
+        }
+        else if (command == "alloc" && argc >= 3)
+        {
+            benchmarkAllocations(std::stoull(argv[2]),
+                                 argc >= 4 ? std::max<size_t>(1, std::stoull(argv[3])) : 1);
+        }
+        else if (command == "sharded" && argc >= 5)
+        {
+            benchmarkSharded(std::stoull(argv[2]), std::stoull(argv[3]), std::stoull(argv[4]));
+        }
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
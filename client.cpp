@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "TreeProtocol.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct ClientOptions
+{
+    std::string socketPath;
+    size_t requests = 1000000;
+    size_t connections = 4;
+    size_t depth = 32;
+    int32_t keyRange = 1000000;
+    int writePercent = 10;
+};
+
+struct ConnectionResult
+{
+    std::vector<double> latenciesUs;
+    size_t errors = 0;
+    size_t noTree = 0;
+};
+
+class Connection
+{
+   private:
+    int fd;
+    std::string input;
+    size_t consumed;
+
+   public:
+    Connection(const std::string& path) : fd(-1), consumed(0)
+    {
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            throw std::runtime_error("Socket path is too long: " + path);
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+        {
+            if (fd >= 0) close(fd);
+            throw std::runtime_error("Cannot connect to " + path);
+        }
+    }
+
+    ~Connection() { close(fd); }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    void sendAll(const std::string& data)
+    {
+        size_t sent = 0;
+        while (sent < data.size())
+        {
+            ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) throw std::runtime_error("Connection lost while sending");
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+    // Blocks until at least one whole response is buffered, then returns the
+    // status of each complete response in arrival order.
+    void receive(std::vector<TreeStatus>& statuses)
+    {
+        statuses.clear();
+        while (true)
+        {
+            while (input.size() - consumed >= treeResponseHeaderSize)
+            {
+                const char* header = input.data() + consumed;
+                uint32_t length = getWire<uint32_t>(header + 5);
+                if (input.size() - consumed < treeResponseHeaderSize + length) break;
+                statuses.push_back(static_cast<TreeStatus>(static_cast<uint8_t>(header[4])));
+                consumed += treeResponseHeaderSize + length;
+            }
+            if (!statuses.empty()) break;
+
+            if (consumed > 0)
+            {
+                input.erase(0, consumed);
+                consumed = 0;
+            }
+            char buffer[65536];
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) throw std::runtime_error("Connection closed by server");
+            input.append(buffer, static_cast<size_t>(n));
+        }
+    }
+};
+
+class RequestMix
+{
+   private:
+    std::mt19937 rng;
+    std::uniform_int_distribution<int32_t> keys;
+    std::uniform_int_distribution<int> percent;
+    int writePercent;
+
+   public:
+    RequestMix(unsigned seed, int32_t keyRange, int writes)
+        : rng(seed), keys(0, keyRange - 1), percent(0, 99), writePercent(writes)
+    {
+    }
+
+    // Writes are split evenly between inserts and removes; reads are 90% point
+    // lookups, 5% range summaries and 5% short scans.
+    TreeRequest next(uint32_t id)
+    {
+        TreeRequest request{id, TreeOp::Search, keys(rng), 0};
+        int roll = percent(rng);
+        if (roll < writePercent)
+        {
+            request.op = roll % 2 == 0 ? TreeOp::Insert : TreeOp::Remove;
+            return request;
+        }
+
+        roll = percent(rng);
+        if (roll >= 95)
+        {
+            request.op = TreeOp::Scan;
+            request.b = 16;
+        }
+        else if (roll >= 90)
+        {
+            request.op = TreeOp::Range;
+            request.b = request.a > INT32_MAX - 1000 ? INT32_MAX : request.a + 1000;
+        }
+        return request;
+    }
+};
+
+// Keeps depth requests in flight on one connection; the server answers each
+// connection in order, so send times are matched to responses through a FIFO.
+ConnectionResult runConnection(const ClientOptions& options, size_t requests, unsigned seed)
+{
+    ConnectionResult result;
+    result.latenciesUs.reserve(requests);
+
+    Connection connection(options.socketPath);
+    RequestMix mix(seed, options.keyRange, options.writePercent);
+    std::deque<Clock::time_point> sentAt;
+    std::vector<TreeStatus> statuses;
+    std::string out;
+    size_t sent = 0;
+    uint32_t nextId = 0;
+
+    auto sendMore = [&](size_t count)
+    {
+        out.clear();
+        Clock::time_point now = Clock::now();
+        for (size_t i = 0; i < count && sent < requests; i++, sent++)
+        {
+            char wire[TreeRequest::wireSize];
+            mix.next(nextId++).encode(wire);
+            out.append(wire, sizeof(wire));
+            sentAt.push_back(now);
+        }
+        if (!out.empty()) connection.sendAll(out);
+    };
+
+    sendMore(options.depth);
+    while (!sentAt.empty())
+    {
+        connection.receive(statuses);
+        Clock::time_point now = Clock::now();
+        for (TreeStatus status : statuses)
+        {
+            result.latenciesUs.push_back(
+                std::chrono::duration<double, std::micro>(now - sentAt.front()).count());
+            sentAt.pop_front();
+            if (status == TreeStatus::NoTree) result.noTree++;
+            if (status == TreeStatus::BadRequest) result.errors++;
+        }
+        sendMore(statuses.size());
+    }
+    return result;
+}
+
+double percentile(const std::vector<double>& sorted, double fraction)
+{
+    if (sorted.empty()) return 0;
+    size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+void printUsage()
+{
+    std::cerr << "Usage: tree_client <socket> [requests] [connections] [depth] [key range] "
+                 "[write %]\n"
+              << "  Sends a mix of lookups, range queries, scans and writes to a server started\n"
+              << "  with '3_3 --serve', keeping <depth> requests in flight per connection, and\n"
+              << "  reports throughput and latency percentiles.\n";
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printUsage();
+        return 1;
+    }
+
+    try
+    {
+        ClientOptions options;
+        options.socketPath = argv[1];
+        if (argc >= 3) options.requests = std::stoull(argv[2]);
+        if (argc >= 4) options.connections = std::max<size_t>(1, std::stoull(argv[3]));
+        if (argc >= 5) options.depth = std::max<size_t>(1, std::stoull(argv[4]));
+        if (argc >= 6) options.keyRange = std::max(1, std::stoi(argv[5]));
+        if (argc >= 7) options.writePercent = std::clamp(std::stoi(argv[6]), 0, 100);
+
+        std::vector<ConnectionResult> results(options.connections);
+        std::vector<std::thread> threads;
+        std::vector<std::string> errors(options.connections);
+
+        Clock::time_point started = Clock::now();
+        for (size_t i = 0; i < options.connections; i++)
+        {
+            size_t share = options.requests / options.connections +
+                           (i < options.requests % options.connections ? 1 : 0);
+            threads.emplace_back(
+                [&, i, share]()
+                {
+                    try
+                    {
+                        results[i] = runConnection(options, share, static_cast<unsigned>(i + 1));
+                    }
+                    catch (const std::exception& e)
+                    {
+                        errors[i] = e.what();
+                    }
+                });
+        }
+        for (std::thread& thread : threads) thread.join();
+        double seconds = std::chrono::duration<double>(Clock::now() - started).count();
+
+        for (const std::string& error : errors)
+        {
+            if (!error.empty()) throw std::runtime_error(error);
+        }
+
+        std::vector<double> latencies;
+        size_t badRequests = 0;
+        size_t noTree = 0;
+        for (const ConnectionResult& result : results)
+        {
+            latencies.insert(latencies.end(), result.latenciesUs.begin(),
+                             result.latenciesUs.end());
+            badRequests += result.errors;
+            noTree += result.noTree;
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        std::cout << latencies.size() << " requests over " << options.connections
+                  << " connections, " << options.depth << " in flight each, "
+                  << options.writePercent << "% writes\n";
+        std::cout << std::fixed << std::setprecision(0) << "QPS        "
+                  << latencies.size() / seconds << "\n";
+        std::cout << std::setprecision(1) << "p50        " << percentile(latencies, 0.50)
+                  << " us\n"
+                  << "p99        " << percentile(latencies, 0.99) << " us\n"
+                  << "p99.9      " << percentile(latencies, 0.999) << " us\n"
+                  << "max        " << (latencies.empty() ? 0 : latencies.back()) << " us\n";
+        if (badRequests > 0 || noTree > 0)
+        {
+            std::cout << badRequests << " bad requests, " << noTree << " without a tree\n";
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+enum class Shape
+{
+    Random,
+    Complete,
+    LeftChain,
+    RightChain,
+    ZigZag
+};
+
+enum class KeyDistribution
+{
+    Uniform,
+    Sequential,
+    Reverse,
+    Duplicates
+};
+
+enum class Malformation
+{
+    None,
+    Unbalanced,
+    ThreeChildren,
+    InvalidChar,
+    MissingNumber,
+    TrailingTree,
+    Empty
+};
+
+struct GeneratorOptions
+{
+    std::string output = "-";
+    size_t nodes = 1000;
+    Shape shape = Shape::Random;
+    KeyDistribution keys = KeyDistribution::Uniform;
+    unsigned long long seed = 1;
+    Malformation malformation = Malformation::None;
+};
+
+class OutputBuffer
+{
+   private:
+    FILE* file;
+    std::string buffer;
+
+   public:
+    OutputBuffer(const std::string& path)
+        : file(path == "-" ? stdout : std::fopen(path.c_str(), "wb"))
+    {
+        if (!file)
+        {
+            throw std::runtime_error("Cannot open output file: " + path);
+        }
+        buffer.reserve(1 << 20);
+    }
+
+    ~OutputBuffer()
+    {
+        if (file != stdout) std::fclose(file);
+    }
+
+    void flush()
+    {
+        if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+        {
+            throw std::runtime_error("Write failed");
+        }
+        buffer.clear();
+    }
+
+    void put(char c)
+    {
+        buffer.push_back(c);
+        if (buffer.size() >= (1 << 20)) flush();
+    }
+
+    void put(const char* text)
+    {
+        while (*text) put(*text++);
+    }
+
+    void putNumber(long long value)
+    {
+        char digits[24];
+        int length = std::snprintf(digits, sizeof(digits), "%lld", value);
+        buffer.append(digits, length);
+        if (buffer.size() >= (1 << 20)) flush();
+    }
+};
+
+class TreeGenerator
+{
+   private:
+    struct Frame
+    {
+        size_t size;
+        size_t depth;
+        size_t leftSize;
+        size_t rightSize;
+        int stage;
+        int children;
+    };
+
+    const GeneratorOptions& options;
+    std::mt19937_64 rng;
+    size_t emitted;
+
+    size_t completeLeftSize(size_t size)
+    {
+        size_t height = 0;
+        while ((size_t(2) << height) - 1 < size) height++;
+        if (height == 0) return 0;
+
+        size_t lastLevelCapacity = size_t(1) << (height - 1);
+        size_t lastLevel = size - ((size_t(1) << height) - 1);
+        return (lastLevelCapacity - 1) + std::min(lastLevel, lastLevelCapacity);
+    }
+
+    size_t leftSizeFor(size_t size, size_t depth)
+    {
+        size_t rest = size - 1;
+        if (rest == 0) return 0;
+
+        switch (options.shape)
+        {
+            case Shape::Random:
+                return std::uniform_int_distribution<size_t>(0, rest)(rng);
+            case Shape::Complete:
+                return completeLeftSize(size);
+            case Shape::LeftChain:
+                return rest;
+            case Shape::RightChain:
+                return 1;
+            case Shape::ZigZag:
+                return depth % 2 == 0 ? rest : 1;
+        }
+        return rest;
+    }
+
+    long long nextKey()
+    {
+        size_t index = emitted++;
+        switch (options.keys)
+        {
+            case KeyDistribution::Uniform:
+                return std::uniform_int_distribution<long long>(-1000000000, 1000000000)(rng);
+            case KeyDistribution::Sequential:
+                return static_cast<long long>(index);
+            case KeyDistribution::Reverse:
+                return static_cast<long long>(options.nodes - index);
+            case KeyDistribution::Duplicates:
+            {
+                size_t distinct = options.nodes / 100 + 1;
+                return std::uniform_int_distribution<long long>(0, distinct - 1)(rng);
+            }
+        }
+        return static_cast<long long>(index);
+    }
+
+   public:
+    TreeGenerator(const GeneratorOptions& opts) : options(opts), rng(opts.seed), emitted(0) {}
+
+    void write(OutputBuffer& out)
+    {
+        if (options.malformation == Malformation::Empty || options.nodes == 0) return;
+
+        size_t brokenNode = options.nodes / 2;
+        std::vector<Frame> stack;
+        stack.push_back({options.nodes, 0, 0, 0, 0, 0});
+
+        while (!stack.empty())
+        {
+            Frame& frame = stack.back();
+
+            if (frame.stage == 0)
+            {
+                bool broken = emitted == brokenNode;
+                out.put('(');
+                if (broken && options.malformation == Malformation::InvalidChar)
+                {
+                    out.put('x');
+                    emitted++;
+                }
+                else if (broken && options.malformation == Malformation::MissingNumber)
+                {
+                    emitted++;
+                }
+                else
+                {
+                    out.putNumber(nextKey());
+                }
+
+                frame.leftSize = leftSizeFor(frame.size, frame.depth);
+                frame.rightSize = frame.size - 1 - frame.leftSize;
+                if (frame.leftSize == 0)
+                {
+                    frame.leftSize = frame.rightSize;
+                    frame.rightSize = 0;
+                }
+                frame.stage = 1;
+
+                if (frame.leftSize > 0)
+                {
+                    frame.children++;
+                    out.put(' ');
+                    stack.push_back({frame.leftSize, frame.depth + 1, 0, 0, 0, 0});
+                }
+            }
+            else if (frame.stage == 1)
+            {
+                frame.stage = 2;
+                if (frame.rightSize > 0)
+                {
+                    frame.children++;
+                    out.put(' ');
+                    stack.push_back({frame.rightSize, frame.depth + 1, 0, 0, 0, 0});
+                }
+            }
+            else
+            {
+                bool isRoot = stack.size() == 1;
+                if (isRoot && options.malformation == Malformation::ThreeChildren)
+                {
+                    for (; frame.children < 3; frame.children++) out.put(" (0)");
+                }
+                if (!(isRoot && options.malformation == Malformation::Unbalanced))
+                {
+                    out.put(')');
+                }
+                stack.pop_back();
+            }
+        }
+
+        if (options.malformation == Malformation::TrailingTree) out.put(" (1)");
+        out.put('\n');
+    }
+};
+
+void printUsage()
+{
+    std::cerr << "Usage: tree_gen [options]\n"
+              << "  -o <file>        output file, '-' for stdout (default)\n"
+              << "  -n <count>       number of nodes (default 1000)\n"
+              << "  -s <shape>       random | complete | left | right | zigzag\n"
+              << "  -k <keys>        uniform | sequential | reverse | duplicates\n"
+              << "  -r <seed>        random seed (default 1)\n"
+              << "  -m <malformed>   none | unbalanced | three-children | invalid-char |\n"
+              << "                   missing-number | trailing | empty\n"
+              << "\nA single child is always written as the left child, so the right chain\n"
+              << "and the right steps of the zig-zag hang the spine off the second slot\n"
+              << "with a one-node left sibling.\n";
+}
+
+GeneratorOptions parseArguments(int argc, char* argv[])
+{
+    GeneratorOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string flag = argv[i];
+        if (flag == "-h" || flag == "--help")
+        {
+            printUsage();
+            std::exit(0);
+        }
+        if (i + 1 >= argc)
+        {
+            throw std::runtime_error("Missing value for " + flag);
+        }
+        std::string value = argv[++i];
+
+        if (flag == "-o")
+        {
+            options.output = value;
+        }
+        else if (flag == "-n")
+        {
+            options.nodes = std::stoull(value);
+        }
+        else if (flag == "-r")
+        {
+            options.seed = std::stoull(value);
+        }
+        else if (flag == "-s")
+        {
+            if (value == "random")
+                options.shape = Shape::Random;
+            else if (value == "complete")
+                options.shape = Shape::Complete;
+            else if (value == "left")
+                options.shape = Shape::LeftChain;
+            else if (value == "right")
+                options.shape = Shape::RightChain;
+            else if (value == "zigzag")
+                options.shape = Shape::ZigZag;
+            else
+                throw std::runtime_error("Unknown shape: " + value);
+        }
+        else if (flag == "-k")
+        {
+            if (value == "uniform")
+                options.keys = KeyDistribution::Uniform;
+            else if (value == "sequential")
+                options.keys = KeyDistribution::Sequential;
+            else if (value == "reverse")
+                options.keys = KeyDistribution::Reverse;
+            else if (value == "duplicates")
+                options.keys = KeyDistribution::Duplicates;
+            else
+                throw std::runtime_error("Unknown key distribution: " + value);
+        }
+        else if (flag == "-m")
+        {
+            if (value == "none")
+                options.malformation = Malformation::None;
+            else if (value == "unbalanced")
+                options.malformation = Malformation::Unbalanced;
+            else if (value == "three-children")
+                options.malformation = Malformation::ThreeChildren;
+            else if (value == "invalid-char")
+                options.malformation = Malformation::InvalidChar;
+            else if (value == "missing-number")
+                options.malformation = Malformation::MissingNumber;
+            else if (value == "trailing")
+                options.malformation = Malformation::TrailingTree;
+            else if (value == "empty")
+                options.malformation = Malformation::Empty;
+            else
+                throw std::runtime_error("Unknown malformation: " + value);
+        }
+        else
+        {
+            throw std::runtime_error("Unknown option: " + flag);
+        }
+    }
+
+    return options;
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        GeneratorOptions options = parseArguments(argc, argv);
+        OutputBuffer out(options.output);
+        TreeGenerator generator(options);
+        generator.write(out);
+        out.flush();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        printUsage();
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -1,164 +1,948 @@
-﻿#include <fstream>
+﻿#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <memory>
-#include <sstream>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "BinaryTree.h"
+#include "FileWatcher.h"
+#include "IntervalTree.h"
+#include "MemoryAccounting.h"
+#include "OperationLog.h"
 #include "Parser.h"
 #include "RBTree.h"
+#include "TreeExport.h"
+#include "TreeLoader.h"
+#include "TreeServer.h"
+#include "TreeWorkspace.h"
 
-std::string readFile(const std::string& filename)
+// Prints node and its subtrees as an indented outline, one line per node. The walk
+// keeps an explicit stack of pending right children and a single prefix buffer;
+// each pending child records how much of the buffer belongs to it, so deep chains
+// need neither recursion nor a copy of the prefix per level. Below levels (when
+// not negative) children are replaced by "...". prepare runs on every node before
+// its children are read; label prints the node itself.
+template <typename Node, typename Prepare, typename Label>
+void printOutline(Node* node, std::string prefix, bool isLeft, int levels, Prepare prepare,
+                  Label label)
 {
-    std::ifstream file(filename);
-    if (!file.is_open())
+    struct Pending
     {
-        throw std::runtime_error("Cannot open file: " + filename);
+        Node* node;
+        size_t prefixLength;
+        bool isLeft;
+        int levels;
+    };
+
+    std::vector<Pending> stack;
+    if (node) stack.push_back({node, prefix.size(), isLeft, levels});
+
+    while (!stack.empty())
+    {
+        Pending current = stack.back();
+        stack.pop_back();
+        prefix.resize(current.prefixLength);
+
+        prepare(current.node);
+
+        std::cout << prefix;
+        std::cout << (current.isLeft ? "|-- " : "|-- ");
+        label(current.node);
+        std::cout << "\n";
+
+        if (!current.node->left && !current.node->right) continue;
+
+        prefix += current.isLeft ? "|   " : "    ";
+        if (current.levels == 0)
+        {
+            std::cout << prefix << "|-- ...\n";
+            continue;
+        }
+
+        if (current.node->right)
+        {
+            stack.push_back({current.node->right, prefix.size(), false, current.levels - 1});
+        }
+        if (current.node->left)
+        {
+            stack.push_back({current.node->left, prefix.size(), true, current.levels - 1});
+        }
+        else
+        {
+            std::cout << prefix << "|-- (empty)\n";
+        }
     }
+}
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+void printBinaryTree(BinaryTree<int>& tree, BinaryTreeNode<int>* node, std::string prefix = "",
+                     bool isLeft = true, int levels = -1)
+{
+    printOutline(node, prefix, isLeft, levels,
+                 [&tree](BinaryTreeNode<int>* current) { tree.expand(current); },
+                 [](BinaryTreeNode<int>* current) { std::cout << current->data; });
 }
 
-void printBinaryTree(BinaryTreeNode<int>* node, std::string prefix = "", bool isLeft = true)
+template <typename Node>
+void printRBTreeHelper(Node* node, std::string prefix = "", bool isLeft = true)
 {
-    if (!node) return;
+    printOutline(node, prefix, isLeft, -1, [](Node*) {},
+                 [](Node* current)
+                 {
+                     std::cout << current->data;
+                     std::cout << (current->color == RED ? "(R)" : "(B)");
+                     if (current->count > 1) std::cout << " x" << current->count;
+                 });
+}
+
+struct TreeMemory
+{
+    size_t nodes;
+    size_t allocatedNodes;
+    size_t nodeBytes;
+    size_t bytesPerNode;
+    size_t extraBytes;
+
+    size_t totalBytes() const { return allocatedNodes * bytesPerNode + extraBytes; }
+};
+
+class TreeManager
+{
+private:
+    std::atomic<std::shared_ptr<TreeSet<int>>> current;
+    std::thread loaderThread;
+    std::atomic<bool> loading;
+    std::unique_ptr<FileWatcher> watcher;
+    TreeWorkspace<int> workspace;
+    std::atomic<bool> countedMode;
+    std::atomic<bool> sharedMode;
+    std::atomic<bool> rbOnlyMode;
+    bool lookupCacheMode;
+    bool filterMode;
+    std::unique_ptr<IntervalTree<int>> intervals;
+    std::unique_ptr<OperationLog<int>> operationLog;
+    std::shared_ptr<TreeSet<int>> loggedTrees;
+    std::mutex logMutex;
+    size_t lastLoadBaseline;
+    size_t lastLoadPeak;
 
-    std::cout << prefix;
-    std::cout << (isLeft ? "|-- " : "|-- ");
-    std::cout << node->data << "\n";
+    static constexpr size_t lookupCacheSlots = 4096;
+    static constexpr double filterFalsePositiveRate = 0.01;
 
-    if (node->left || node->right)
+    static TreeMemory binaryTreeMemory(BinaryTree<int>& tree)
     {
-        if (node->left)
+        TreeMemory memory{0, 0, sizeof(BinaryTreeNode<int>),
+                          MemoryAccounting::footprint(sizeof(BinaryTreeNode<int>)), 0};
+        if (tree.isLazy())
         {
-            printBinaryTree(node->left, prefix + (isLeft ? "|   " : "    "), true);
+            memory.nodes = tree.sourceNodeCount();
+            memory.allocatedNodes = tree.materializedCount();
+            memory.extraBytes = tree.sourceBytes();
+            return memory;
         }
-        else if (node->right)
+
+        tree.traverse([&memory](int) { memory.nodes++; });
+        memory.allocatedNodes = tree.isShared() ? tree.storedNodeCount() : memory.nodes;
+        return memory;
+    }
+
+    static TreeMemory rbTreeMemory(const TreeSet<int>::RBTreeType& tree)
+    {
+        using Node = TreeSet<int>::RBTreeType::Node;
+        return {tree.totalCount(), tree.size(), sizeof(Node),
+                MemoryAccounting::footprint(sizeof(Node)), 0};
+    }
+
+    static void printTreeMemory(const std::string& name, const TreeMemory& memory)
+    {
+        std::cout << std::left << std::setw(16) << name << std::right << std::setw(12)
+                  << memory.nodes << " nodes, " << std::setw(12) << memory.allocatedNodes
+                  << " allocated x " << memory.bytesPerNode << " B (" << memory.nodeBytes
+                  << " B object) = " << memory.totalBytes() << " B\n";
+    }
+
+    static void writeTreeMemory(std::ostream& out, const TreeMemory& memory)
+    {
+        out << "{\"nodes\": " << memory.nodes << ", \"allocatedNodes\": " << memory.allocatedNodes
+            << ", \"nodeBytes\": " << memory.nodeBytes << ", \"bytesPerNode\": "
+            << memory.bytesPerNode << ", \"extraBytes\": " << memory.extraBytes
+            << ", \"totalBytes\": " << memory.totalBytes() << "}";
+    }
+
+    LoadOptions loadOptions() const
+    {
+        LoadOptions options;
+        options.counted = countedMode;
+        options.shareSubtrees = sharedMode;
+        options.keepBinaryTree = !rbOnlyMode;
+        return options;
+    }
+
+    std::shared_ptr<TreeSet<int>> acquire(bool needRBTree = true)
+    {
+        std::shared_ptr<TreeSet<int>> trees = current.load();
+        if (!trees)
+        {
+            std::cout << "\nNo tree loaded. Please load a tree first.\n";
+        }
+        else if (needRBTree && !trees->rbTree)
         {
-            std::cout << prefix << (isLeft ? "|   " : "    ") << "|-- (empty)\n";
+            std::cout << "\nBuilding Red-Black tree from the lazily opened file...\n";
+            buildRBTree(*trees);
         }
 
-        if (node->right)
+        // Only the menu thread searches these trees, so the cache is safe here
+        if (trees && trees->rbTree && trees->rbTree->hasLookupCache() != lookupCacheMode)
         {
-            printBinaryTree(node->right, prefix + (isLeft ? "|   " : "    "), false);
+            if (lookupCacheMode)
+            {
+                trees->rbTree->enableLookupCache(lookupCacheSlots);
+            }
+            else
+            {
+                trees->rbTree->disableLookupCache();
+            }
         }
+        if (trees && trees->rbTree && trees->rbTree->hasMembershipFilter() != filterMode)
+        {
+            if (filterMode)
+            {
+                trees->rbTree->enableMembershipFilter(filterFalsePositiveRate);
+            }
+            else
+            {
+                trees->rbTree->disableMembershipFilter();
+            }
+        }
+        return trees;
     }
-}
 
-void printRBTreeHelper(RBNode<int>* node, std::string prefix = "", bool isLeft = true)
-{
-    if (!node) return;
+    bool logMutation(const std::shared_ptr<TreeSet<int>>& trees, LogOperation operation, int value)
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        if (!operationLog) return true;
 
-    std::cout << prefix;
-    std::cout << (isLeft ? "|-- " : "|-- ");
-    std::cout << node->data;
-    std::cout << (node->color == RED ? "(R)" : "(B)");
-    std::cout << "\n";
+        try
+        {
+            if (trees != loggedTrees)
+            {
+                operationLog->checkpoint(*trees->rbTree);
+                loggedTrees = trees;
+            }
+            operationLog->append(operation, value);
+            return true;
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "\nOperation log error: " << e.what() << " (change not applied)\n";
+            return false;
+        }
+    }
 
-    if (node->left || node->right)
+    void checkpointIfDue(const std::shared_ptr<TreeSet<int>>& trees)
     {
-        if (node->left)
+        std::lock_guard<std::mutex> lock(logMutex);
+        if (!operationLog || !operationLog->needsCheckpoint()) return;
+
+        try
         {
-            printRBTreeHelper(node->left, prefix + (isLeft ? "|   " : "    "), true);
+            operationLog->checkpoint(*trees->rbTree);
+            std::cout << "Checkpoint " << operationLog->currentGeneration() << " written.\n";
         }
-        else if (node->right)
+        catch (const std::exception& e)
         {
-            std::cout << prefix << (isLeft ? "|   " : "    ") << "|-- (empty)\n";
+            std::cout << "\nCheckpoint failed: " << e.what() << "\n";
         }
+    }
 
-        if (node->right)
+    // Called when trees replaces the logged tree or was changed without logging:
+    // the log then no longer describes the tree in memory, so it starts over from a
+    // checkpoint of trees. If that fails, the next logged change checkpoints first.
+    void checkpointReplaced(const std::shared_ptr<TreeSet<int>>& trees)
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        if (!operationLog) return;
+
+        try
+        {
+            if (!trees->rbTree) buildRBTree(*trees);
+            operationLog->checkpoint(*trees->rbTree);
+            loggedTrees = trees;
+            std::cout << "Checkpoint " << operationLog->currentGeneration() << " written.\n";
+        }
+        catch (const std::exception& e)
         {
-            printRBTreeHelper(node->right, prefix + (isLeft ? "|   " : "    "), false);
+            loggedTrees.reset();
+            std::cout << "\nCheckpoint failed: " << e.what() << "\n";
         }
     }
-}
 
-class TreeManager
-{
-private:
-    std::unique_ptr<BinaryTree<int>> binaryTree;
-    std::unique_ptr<RBTree<int>> rbTree;
-    bool treeLoaded;
-    std::string currentFile;
+    void publishFromFile(const std::string& filename)
+    {
+        auto started = std::chrono::steady_clock::now();
+        try
+        {
+            std::shared_ptr<TreeSet<int>> trees = loadTreeSet<int>(filename, loadOptions());
+            checkpointReplaced(trees);
+            current.store(trees);
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - started);
+            std::cout << "\n[background] Tree from " << filename << " published ("
+                      << elapsed.count() << " ms)\n";
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "\n[background] Error loading tree: " << e.what()
+                      << " (current tree kept)\n";
+        }
+    }
 
 public:
-    TreeManager() : treeLoaded(false)
+    TreeManager()
+        : loading(false),
+          countedMode(false),
+          sharedMode(false),
+          rbOnlyMode(false),
+          lookupCacheMode(false),
+          filterMode(false),
+          lastLoadBaseline(0),
+          lastLoadPeak(0)
+    {
+    }
+
+    ~TreeManager()
     {
+        watcher.reset();
+        if (loaderThread.joinable()) loaderThread.join();
     }
 
     void loadFromFile(const std::string& filename)
     {
+        lastLoadBaseline = MemoryAccounting::live();
+        MemoryAccounting::resetPeak();
+
         try
         {
-            std::string content = readFile(filename);
             std::cout << "        Loading Tree from File         \n";
             std::cout << "\nFile: " << filename << "\n";
-            std::cout << "Content: " << content << "\n";
 
-            Parser<int> parser(content);
-            BinaryTreeNode<int>* treeRoot = parser.parse();
+            PipelineStats stats;
+            std::shared_ptr<TreeSet<int>> trees = loadTreeSet<int>(filename, loadOptions(), &stats);
+            checkpointReplaced(trees);
+            current.store(trees);
 
-            binaryTree = std::make_unique<BinaryTree<int>>();
-            binaryTree->setRoot(treeRoot);
+            if (stats.bytes <= 4096)
+            {
+                std::cout << "Content: " << readFile(filename) << "\n";
+            }
+            std::cout << "Loaded " << stats.bytes << " bytes, " << stats.nodes << " nodes in "
+                      << std::fixed << std::setprecision(2) << stats.totalMs << " ms (read "
+                      << stats.readMs << ", parse " << stats.parseMs << ", build "
+                      << stats.buildMs << " ms)\n";
 
-            rbTree = std::make_unique<RBTree<int>>();
-            binaryTree->traverse([this](int val) { rbTree->insert(val); });
+            if (rbOnlyMode)
+            {
+                std::cout << "\nRed-Black tree built directly from the file; the binary tree "
+                             "was not kept.\n";
+            }
+            else
+            {
+                std::cout << "\nBinary tree successfully loaded!\n";
+                if (trees->binaryTree->isShared())
+                {
+                    std::cout << "Identical subtrees shared: "
+                              << trees->binaryTree->storedNodeCount() << " nodes stored.\n";
+                }
+                std::cout << "Red-Black tree created from binary tree!\n";
+            }
+            lastLoadPeak = MemoryAccounting::peak();
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "\nError loading tree: " << e.what() << "\n";
+            current.store(nullptr);
+        }
+    }
+
+    void loadInBackground(const std::string& filename)
+    {
+        if (loading)
+        {
+            std::cout << "\nA background load is already running.\n";
+            return;
+        }
+        if (loaderThread.joinable()) loaderThread.join();
+
+        loading = true;
+        loaderThread = std::thread(
+            [this, filename]()
+            {
+                publishFromFile(filename);
+                loading = false;
+            });
+        std::cout << "\nLoading " << filename
+                  << " in background; queries keep using the current tree.\n";
+    }
 
-            treeLoaded = true;
-            currentFile = filename;
+    std::shared_ptr<TreeSet<int>> snapshot() const { return current.load(); }
 
-            std::cout << "\nBinary tree successfully loaded!\n";
-            std::cout << "Red-Black tree created from binary tree!\n";
+    bool isWatching() const { return watcher != nullptr; }
+
+    void watchFile(const std::string& filename)
+    {
+        try
+        {
+            auto fileWatcher = std::make_unique<FileWatcher>(
+                filename, [this, filename]() { publishFromFile(filename); });
+            fileWatcher->start();
+            watcher = std::move(fileWatcher);
+            std::cout << "\nWatching " << filename << "; the tree is reloaded on every change.\n";
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "\nError watching file: " << e.what() << "\n";
+        }
+    }
+
+    void stopWatching()
+    {
+        std::cout << "\nStopped watching " << watcher->getPath() << ".\n";
+        watcher.reset();
+    }
+
+    void reloadFromFile(const std::string& filename)
+    {
+        std::shared_ptr<TreeSet<int>> trees = current.load();
+        if (!trees)
+        {
+            loadFromFile(filename);
+            return;
+        }
+        acquire();
+
+        try
+        {
+            std::string content = readFile(filename);
+            std::cout << "       Reloading Tree (Apply Diff)     \n";
+            std::cout << "\nFile: " << filename << "\n";
+
+            // Finding the diff still reads the whole file, sorts its m keys and walks
+            // the n keys of the RB tree, O(m log m + n); only the RB tree edits,
+            // O(d log n) for d changed keys, are proportional to the change.
+            LoadOptions options = loadOptions();
+            std::unique_ptr<BinaryTree<int>> freshTree;
+            std::vector<int> freshKeys;
+            if (options.keepBinaryTree)
+            {
+                KeyCollector<int> collector;
+                freshTree = parseBinaryTree<int>(content, options, &collector);
+                freshKeys = std::move(collector.keys);
+            }
+            else
+            {
+                freshTree = std::make_unique<BinaryTree<int>>();
+                freshKeys = parseKeys<int>(content);
+            }
+            std::sort(freshKeys.begin(), freshKeys.end());
+            if (!trees->rbTree->isCounted())
+            {
+                freshKeys.erase(std::unique(freshKeys.begin(), freshKeys.end()),
+                                freshKeys.end());
+            }
+
+            std::vector<int> toInsert;
+            std::vector<int> toRemove;
+            size_t unchanged = 0;
+            size_t next = 0;
+            trees->rbTree->inorderTraversal(
+                [&](int val)
+                {
+                    while (next < freshKeys.size() && freshKeys[next] < val)
+                    {
+                        toInsert.push_back(freshKeys[next++]);
+                    }
+                    if (next < freshKeys.size() && freshKeys[next] == val)
+                    {
+                        next++;
+                        unchanged++;
+                    }
+                    else
+                    {
+                        toRemove.push_back(val);
+                    }
+                });
+            toInsert.insert(toInsert.end(), freshKeys.begin() + next, freshKeys.end());
+
+            for (int val : toRemove) trees->rbTree->remove(val);
+            trees->rbTree->setFingerInsertion(true);
+            for (int val : toInsert) trees->rbTree->insert(val);
+            trees->rbTree->setFingerInsertion(false);
+
+            trees->binaryTree = std::move(freshTree);
+            trees->file = filename;
+            checkpointReplaced(trees);
+
+            if (options.keepBinaryTree)
+            {
+                std::cout << "\nBinary tree replaced with the new file contents.\n";
+            }
+            std::cout << "Red-Black tree updated: +" << toInsert.size() << " inserted, -"
+                      << toRemove.size() << " removed, " << unchanged << " unchanged.\n";
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "\nError reloading tree: " << e.what() << "\n";
+            std::cout << "Previously loaded trees are kept.\n";
+        }
+    }
+
+    void loadDirectory(const std::string& directory)
+    {
+        try
+        {
+            size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+            auto started = std::chrono::steady_clock::now();
+            std::vector<LoadReport> reports =
+                workspace.loadDirectory(directory, threadCount, loadOptions());
+            auto elapsed = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - started);
+
+            std::cout << "      Loading Directory into Workspace \n";
+            std::cout << "\nDirectory: " << directory << " (" << threadCount << " threads)\n\n";
+
+            size_t failed = 0;
+            for (const LoadReport& report : reports)
+            {
+                std::cout << std::left << std::setw(24) << report.name << std::right;
+                if (report.ok)
+                {
+                    std::cout << std::setw(12) << report.bytes << " bytes  read " << std::fixed
+                              << std::setprecision(2) << report.readMs << " ms  build "
+                              << report.buildMs << " ms\n";
+                }
+                else
+                {
+                    std::cout << " ERROR: " << report.error << "\n";
+                    failed++;
+                }
+            }
+
+            std::cout << "\n" << reports.size() - failed << " loaded, " << failed << " failed in "
+                      << std::fixed << std::setprecision(2) << elapsed.count() << " ms\n";
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "\nError loading directory: " << e.what() << "\n";
+        }
+    }
+
+    void listWorkspace()
+    {
+        std::cout << "\nWorkspace trees:";
+        for (const std::string& name : workspace.names()) std::cout << " " << name;
+        std::cout << "\n";
+    }
+
+    void selectTree(const std::string& name)
+    {
+        std::shared_ptr<TreeSet<int>> trees = workspace.get(name);
+        if (!trees)
+        {
+            std::cout << "\nNo tree named " << name << " in the workspace.\n";
+            return;
+        }
+
+        current.store(trees);
+        std::cout << "\nActive tree: " << name << " (" << trees->file << ")\n";
+    }
+
+    void toggleCountedMode()
+    {
+        countedMode = !countedMode;
+        std::cout << "\nCounted multiset mode " << (countedMode ? "ON" : "OFF")
+                  << ": applies to trees loaded from now on.\n";
+    }
+
+    void toggleSharedMode()
+    {
+        sharedMode = !sharedMode;
+        std::cout << "\nSharing identical subtrees " << (sharedMode ? "ON" : "OFF")
+                  << ": applies to trees loaded from now on.\n";
+    }
+
+    void toggleRBOnlyMode()
+    {
+        rbOnlyMode = !rbOnlyMode;
+        std::cout << "\nRed-Black tree only loading " << (rbOnlyMode ? "ON" : "OFF")
+                  << ": applies to trees loaded from now on.\n";
+    }
+
+    void toggleLookupCache()
+    {
+        lookupCacheMode = !lookupCacheMode;
+        std::cout << "\nLookup cache for RB Tree searches " << (lookupCacheMode ? "ON" : "OFF")
+                  << " (" << lookupCacheSlots << " slots).\n";
+    }
+
+    void toggleMembershipFilter()
+    {
+        filterMode = !filterMode;
+        std::cout << "\nMembership filter for RB Tree searches " << (filterMode ? "ON" : "OFF")
+                  << " (" << filterFalsePositiveRate * 100 << "% false positives).\n";
+    }
+
+    void rankInRBTree()
+    {
+        std::shared_ptr<TreeSet<int>> trees = acquire();
+        if (!trees) return;
+
+        std::cout << "\nEnter value: ";
+        int value;
+        std::cin >> value;
+
+        if (std::cin.fail())
+        {
+            std::cin.clear();
+            std::cin.ignore(10000, '\n');
+            std::cout << "\nInvalid input!\n";
+            return;
+        }
+
+        TreeSet<int>::RBTreeType& rbTree = *trees->rbTree;
+        std::cout << "\nValue " << value << ": count " << rbTree.count(value) << ", rank "
+                  << rbTree.rank(value) << " of " << rbTree.totalCount() << " elements ("
+                  << rbTree.size() << " distinct)\n";
+    }
+
+    void openLazily(const std::string& filename)
+    {
+        try
+        {
+            auto started = std::chrono::steady_clock::now();
+            std::string content = readFile(filename);
+            size_t bytes = content.size();
+            std::shared_ptr<TreeSet<int>> trees =
+                openTreeSetLazily<int>(std::move(content), filename, loadOptions());
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - started);
+
+            current.store(trees);
+
+            std::cout << "        Opening Tree File Lazily       \n";
+            std::cout << "\nFile: " << filename << " (" << bytes << " bytes)\n";
+            std::cout << "Indexed " << trees->binaryTree->sourceNodeCount() << " nodes in "
+                      << elapsed.count() << " ms; nodes are parsed when first visited.\n";
+            std::cout << "The Red-Black tree is built on first use.\n";
         }
         catch (const std::exception& e)
         {
             std::cout << "\nError loading tree: " << e.what() << "\n";
-            treeLoaded = false;
+            current.store(nullptr);
         }
     }
 
-    void visualizeBinaryTree()
+    void rangeQueryInRBTree()
     {
-        if (!treeLoaded)
+        std::shared_ptr<TreeSet<int>> trees = acquire();
+        if (!trees) return;
+
+        std::cout << "\nEnter range bounds (lo hi): ";
+        int lo, hi;
+        std::cin >> lo >> hi;
+
+        if (std::cin.fail())
         {
-            std::cout << "\nNo tree loaded. Please load a tree first.\n";
+            std::cin.clear();
+            std::cin.ignore(10000, '\n');
+            std::cout << "\nInvalid input!\n";
             return;
         }
 
-        std::cout << "    Binary Tree Visualization          \n";
-        std::cout << "\nRoot\n";
-        printBinaryTree(binaryTree->getRoot(), "", true);
+        RangeSummary<int>::value_type summary = trees->rbTree->rangeQuery(lo, hi);
+        std::cout << "\nRange [" << lo << ", " << hi << "]: " << summary.count << " elements";
+        if (summary.count > 0)
+        {
+            std::cout << ", sum " << summary.sum << ", min " << summary.min << ", max "
+                      << summary.max;
+        }
+        std::cout << "\n";
     }
 
-    void visualizeRBTree()
+    void loadIntervals(const std::string& filename)
     {
-        if (!treeLoaded)
+        try
         {
-            std::cout << "\nNo tree loaded. Please load a tree first.\n";
+            IntervalParser<int> parser(readFile(filename));
+            std::vector<Interval<int>> parsed = parser.parse();
+
+            auto tree = std::make_unique<IntervalTree<int>>();
+            for (const Interval<int>& interval : parsed) tree->insert(interval);
+            intervals = std::move(tree);
+
+            std::cout << "\n" << parsed.size() << " intervals loaded from " << filename << "\n";
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "\nError loading intervals: " << e.what() << "\n";
+        }
+    }
+
+    void findOverlaps()
+    {
+        if (!intervals)
+        {
+            std::cout << "\nNo intervals loaded. Please load intervals first.\n";
+            return;
+        }
+
+        std::cout << "\nEnter query interval (start end, equal for a point): ";
+        int start, end;
+        std::cin >> start >> end;
+
+        if (std::cin.fail() || end < start)
+        {
+            std::cin.clear();
+            std::cin.ignore(10000, '\n');
+            std::cout << "\nInvalid input!\n";
+            return;
+        }
+
+        Interval<int> query{start, end};
+        if (!intervals->overlaps(query))
+        {
+            std::cout << "\nNo intervals overlap [" << start << ", " << end << "]\n";
             return;
         }
 
+        std::cout << "\nOverlapping intervals: ";
+        bool first = true;
+        intervals->forEachOverlap(query,
+                                  [&first](const Interval<int>& interval)
+                                  {
+                                      if (!first) std::cout << ", ";
+                                      std::cout << "[" << interval.start << ", " << interval.end
+                                                << "]";
+                                      first = false;
+                                  });
+        std::cout << "\n";
+    }
+
+    void memoryReport()
+    {
+        std::shared_ptr<TreeSet<int>> trees = acquire(false);
+        if (!trees) return;
+
+        std::cout << "          Memory Report                \n";
+        std::cout << "\nFile: " << trees->file << "\n\n";
+        printTreeMemory("Binary tree", binaryTreeMemory(*trees->binaryTree));
+        if (trees->binaryTree->isLazy())
+        {
+            std::cout << "  lazy source text and index: " << trees->binaryTree->sourceBytes()
+                      << " B\n";
+        }
+        if (trees->rbTree)
+        {
+            printTreeMemory("Red-Black tree", rbTreeMemory(*trees->rbTree));
+        }
+
+        if (!MemoryAccounting::isEnabled())
+        {
+            std::cout << "\nAllocation counting is off; run with TREE_MEMORY_ACCOUNTING=1 to "
+                         "enable it.\n";
+            return;
+        }
+        std::cout << "\nLive heap: " << MemoryAccounting::live() << " B in "
+                  << MemoryAccounting::blocks() << " blocks (" << MemoryAccounting::allocations()
+                  << " allocations so far)\n";
+        if (lastLoadPeak > 0)
+        {
+            std::cout << "Peak during last load: " << lastLoadPeak << " B ("
+                      << lastLoadPeak - std::min(lastLoadPeak, lastLoadBaseline)
+                      << " B above the heap before loading)\n";
+        }
+    }
+
+    void dumpMemoryReport(const std::string& filename)
+    {
+        std::shared_ptr<TreeSet<int>> trees = acquire(false);
+        if (!trees) return;
+
+        std::ofstream out(filename);
+        if (!out.is_open())
+        {
+            std::cout << "\nCannot open file: " << filename << "\n";
+            return;
+        }
+
+        out << "{\n  \"file\": \"" << trees->file << "\",\n  \"binaryTree\": ";
+        writeTreeMemory(out, binaryTreeMemory(*trees->binaryTree));
+        if (trees->rbTree)
+        {
+            out << ",\n  \"rbTree\": ";
+            writeTreeMemory(out, rbTreeMemory(*trees->rbTree));
+        }
+        out << ",\n  \"heap\": {\"accounting\": "
+            << (MemoryAccounting::isEnabled() ? "true" : "false")
+            << ", \"liveBytes\": " << MemoryAccounting::live()
+            << ", \"liveBlocks\": " << MemoryAccounting::blocks()
+            << ", \"allocations\": " << MemoryAccounting::allocations()
+            << ", \"lastLoadBaselineBytes\": " << lastLoadBaseline
+            << ", \"lastLoadPeakBytes\": " << lastLoadPeak << "}\n}\n";
+
+        std::cout << "\nMemory report written to " << filename << "\n";
+    }
+
+    bool isLogging() const { return operationLog != nullptr; }
+
+    void startOperationLog(const std::string& directory)
+    {
+        try
+        {
+            auto log = std::make_unique<OperationLog<int>>(directory);
+            std::shared_ptr<TreeSet<int>> trees;
+            if (log->hasState())
+            {
+                trees = std::make_shared<TreeSet<int>>();
+                trees->binaryTree = std::make_unique<BinaryTree<int>>();
+                trees->file = directory;
+            }
+            else
+            {
+                trees = current.load();
+                if (!trees)
+                {
+                    std::cout << "\nNo tree loaded and no saved state in " << directory << ".\n";
+                    return;
+                }
+                if (!trees->rbTree) buildRBTree(*trees);
+            }
+
+            auto started = std::chrono::steady_clock::now();
+            RecoveryReport report = log->recover(trees->rbTree, trees->counted);
+            auto elapsed = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - started);
+            trees->counted = report.counted;
+
+            {
+                std::lock_guard<std::mutex> lock(logMutex);
+                operationLog = std::move(log);
+                loggedTrees = trees;
+            }
+            current.store(trees);
+
+            if (report.checkpointFound)
+            {
+                std::cout << "\nRecovered " << trees->rbTree->totalCount() << " keys from "
+                          << directory << ": checkpoint " << report.generation << " with "
+                          << report.checkpointKeys << " keys, " << report.replayedOperations
+                          << " logged operations replayed in " << std::fixed
+                          << std::setprecision(2) << elapsed.count() << " ms\n";
+                if (report.tornTail)
+                {
+                    std::cout << "An incomplete batch at the end of the log was dropped.\n";
+                }
+                std::cout << "The binary tree is not part of the saved state and is empty.\n";
+            }
+            else
+            {
+                std::cout << "\nLogging Red-Black tree changes to " << directory << ".\n";
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "\nError opening operation log: " << e.what() << "\n";
+        }
+    }
+
+    void stopOperationLog()
+    {
+        std::cout << "\nStopped logging to " << operationLog->getDirectory() << " after "
+                  << operationLog->commitCount() << " commits.\n";
+        std::lock_guard<std::mutex> lock(logMutex);
+        operationLog.reset();
+        loggedTrees.reset();
+    }
+
+    void exportTree(const std::string& which, const std::string& formatName,
+                    const std::string& filename)
+    {
+        std::shared_ptr<TreeSet<int>> trees = acquire(which == "rb");
+        if (!trees) return;
+
+        try
+        {
+            ExportFormat format = parseExportFormat(formatName);
+            auto started = std::chrono::steady_clock::now();
+            ExportResult result;
+            if (which == "rb")
+            {
+                result = exportRBTree(*trees->rbTree, filename, format);
+            }
+            else if (which == "binary")
+            {
+                result = exportBinaryTree(*trees->binaryTree, filename, format);
+            }
+            else
+            {
+                std::cout << "\nUnknown tree: " << which << " (expected binary or rb)\n";
+                return;
+            }
+            auto elapsed = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - started);
+            std::cout << "\nExported " << result.nodes << " nodes (" << result.bytes
+                      << " bytes) to " << filename << " in " << std::fixed
+                      << std::setprecision(2) << elapsed.count() << " ms\n";
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "\nError exporting tree: " << e.what() << "\n";
+        }
+    }
+
+    void visualizeBinaryTree(int levels = -1)
+    {
+        std::shared_ptr<TreeSet<int>> trees = acquire(false);
+        if (!trees) return;
+
+        std::cout << "    Binary Tree Visualization          \n";
+        std::cout << "\nRoot\n";
+        printBinaryTree(*trees->binaryTree, trees->binaryTree->getRoot(), "", true, levels);
+
+        if (trees->binaryTree->isLazy())
+        {
+            std::cout << "\nMaterialized " << trees->binaryTree->materializedCount() << " of "
+                      << trees->binaryTree->sourceNodeCount() << " nodes\n";
+        }
+    }
+
+    void visualizeRBTree()
+    {
+        std::shared_ptr<TreeSet<int>> trees = acquire();
+        if (!trees) return;
+
         std::cout << "  Red-Black Tree Visualization         \n";
         std::cout << "\n(R) = Red, (B) = Black\n";
         std::cout << "\nRoot\n";
-        printRBTreeHelper(rbTree->getRoot(), "", true);
+        printRBTreeHelper(trees->rbTree->getRoot(), "", true);
     }
 
     void traverseBinaryTree()
     {
-        if (!treeLoaded)
-        {
-            std::cout << "\nNo tree loaded. Please load a tree first.\n";
-            return;
-        }
+        std::shared_ptr<TreeSet<int>> trees = acquire(false);
+        if (!trees) return;
 
         std::cout << " Binary Tree Traversal (Preorder)      \n";
         std::cout << "\nNodes: ";
         bool first = true;
-        binaryTree->traverse(
+        trees->binaryTree->traverse(
             [&first](int val)
             {
                 if (!first) std::cout << " -> ";
@@ -170,17 +954,14 @@ public:
 
     void traverseRBTree()
     {
-        if (!treeLoaded)
-        {
-            std::cout << "\nNo tree loaded. Please load a tree first.\n";
-            return;
-        }
+        std::shared_ptr<TreeSet<int>> trees = acquire();
+        if (!trees) return;
 
         std::cout << "   Red-Black Tree All Traversals       \n";
 
         std::cout << "\nInorder (Sorted): ";
         bool first = true;
-        rbTree->inorderTraversalWithColor(
+        trees->rbTree->inorderTraversalWithColor(
             [&first](int val, Color color)
             {
                 if (!first) std::cout << " -> ";
@@ -190,7 +971,7 @@ public:
 
         std::cout << "\n\nPreorder: ";
         first = true;
-        rbTree->preorderTraversalWithColor(
+        trees->rbTree->preorderTraversalWithColor(
             [&first](int val, Color color)
             {
                 if (!first) std::cout << " -> ";
@@ -200,7 +981,7 @@ public:
 
         std::cout << "\n\nPostorder: ";
         first = true;
-        rbTree->postorderTraversalWithColor(
+        trees->rbTree->postorderTraversalWithColor(
             [&first](int val, Color color)
             {
                 if (!first) std::cout << " -> ";
@@ -210,7 +991,7 @@ public:
 
         std::cout << "\n\nBreadth-First (Level Order): ";
         first = true;
-        rbTree->breadthFirstTraversalWithColor(
+        trees->rbTree->breadthFirstTraversalWithColor(
             [&first](int val, Color color)
             {
                 if (!first) std::cout << " -> ";
@@ -222,11 +1003,8 @@ public:
 
     void insertToRBTree()
     {
-        if (!treeLoaded)
-        {
-            std::cout << "\nNo tree loaded. Please load a tree first.\n";
-            return;
-        }
+        std::shared_ptr<TreeSet<int>> trees = acquire();
+        if (!trees) return;
 
         std::cout << "\nEnter value to insert: ";
         int value;
@@ -240,17 +1018,16 @@ public:
             return;
         }
 
-        rbTree->insert(value);
+        if (!logMutation(trees, LogOperation::Insert, value)) return;
+        trees->rbTree->insert(value);
         std::cout << "\nValue " << value << " successfully inserted into Red-Black tree!\n";
+        checkpointIfDue(trees);
     }
 
     void deleteFromRBTree()
     {
-        if (!treeLoaded)
-        {
-            std::cout << "\nNo tree loaded. Please load a tree first.\n";
-            return;
-        }
+        std::shared_ptr<TreeSet<int>> trees = acquire();
+        if (!trees) return;
 
         std::cout << "\nEnter value to delete: ";
         int value;
@@ -264,10 +1041,12 @@ public:
             return;
         }
 
-        if (rbTree->search(value))
+        if (trees->rbTree->search(value))
         {
-            rbTree->remove(value);
+            if (!logMutation(trees, LogOperation::Remove, value)) return;
+            trees->rbTree->remove(value);
             std::cout << "\nValue " << value << " successfully deleted from Red-Black tree!\n";
+            checkpointIfDue(trees);
         }
         else
         {
@@ -277,11 +1056,8 @@ public:
 
     void searchInRBTree()
     {
-        if (!treeLoaded)
-        {
-            std::cout << "\nNo tree loaded. Please load a tree first.\n";
-            return;
-        }
+        std::shared_ptr<TreeSet<int>> trees = acquire();
+        if (!trees) return;
 
         std::cout << "\nEnter value to search: ";
         int value;
@@ -295,7 +1071,7 @@ public:
             return;
         }
 
-        if (rbTree->search(value))
+        if (trees->rbTree->search(value))
         {
             std::cout << "\nValue " << value << " FOUND in Red-Black tree!\n";
         }
@@ -303,6 +1079,25 @@ public:
         {
             std::cout << "\nValue " << value << " NOT FOUND in Red-Black tree!\n";
         }
+
+        if (trees->rbTree->hasLookupCache())
+        {
+            LookupCacheStats stats = trees->rbTree->lookupCacheStats();
+            std::cout << "Lookup cache: " << stats.hits << " hits, " << stats.misses
+                      << " misses (" << std::fixed << std::setprecision(1)
+                      << stats.hitRate() * 100 << "% hit rate), " << stats.invalidations
+                      << " invalidations\n";
+        }
+        if (trees->rbTree->hasMembershipFilter())
+        {
+            MembershipFilterStats stats = trees->rbTree->membershipFilterStats();
+            std::cout << "Membership filter: " << stats.keys << " keys in " << stats.bytes()
+                      << " B, " << stats.rejected << " of " << stats.queries
+                      << " lookups rejected, " << stats.falsePositives << " false positives ("
+                      << std::fixed << std::setprecision(2) << stats.observedRate() * 100
+                      << "% observed, " << stats.expectedRate * 100 << "% expected, "
+                      << stats.targetRate * 100 << "% target)\n";
+        }
     }
 };
 
@@ -317,11 +1112,91 @@ void printMenu()
     std::cout << " 6. Insert element to RB Tree           \n";
     std::cout << " 7. Delete element from RB Tree         \n";
     std::cout << " 8. Search element in RB Tree           \n";
+    std::cout << " 9. Reload tree from file (apply diff)  \n";
+    std::cout << "10. Load tree in background             \n";
+    std::cout << "11. Watch file and reload (toggle)      \n";
+    std::cout << "12. Load directory into workspace       \n";
+    std::cout << "13. Select workspace tree by name       \n";
+    std::cout << "14. Counted multiset mode (toggle)      \n";
+    std::cout << "15. Count and rank of element in RB Tree\n";
+    std::cout << "16. Open tree file lazily               \n";
+    std::cout << "17. Visualize Binary Tree (top levels)  \n";
+    std::cout << "18. Share identical subtrees (toggle)   \n";
+    std::cout << "19. Range sum/min/max in RB Tree        \n";
+    std::cout << "20. Load intervals from file            \n";
+    std::cout << "21. Find overlapping intervals          \n";
+    std::cout << "22. Memory report                       \n";
+    std::cout << "23. Write memory report as JSON         \n";
+    std::cout << "24. Export tree (DOT/JSON/CSV)          \n";
+    std::cout << "25. Operation log and recovery (toggle) \n";
+    std::cout << "26. Load Red-Black tree only (toggle)   \n";
+    std::cout << "27. RB Tree lookup cache (toggle)       \n";
+    std::cout << "28. RB Tree membership filter (toggle)  \n";
     std::cout << " 0. Exit                                \n";
 }
 
-int main()
+TreeServer* activeServer = nullptr;
+
+void stopServer(int)
+{
+    if (activeServer) activeServer->stop();
+}
+
+// 3_3 --serve <socket> <tree file> [threads]: loads the tree and answers
+// TreeProtocol requests until SIGINT or SIGTERM.
+int serve(int argc, char* argv[])
 {
+    const char* usage = "Usage: 3_3 --serve <socket> <tree file> [threads]\n";
+    if (argc < 4)
+    {
+        std::cerr << usage;
+        return 1;
+    }
+
+    size_t threads = std::thread::hardware_concurrency();
+    if (argc >= 5)
+    {
+        const char* end = argv[4] + std::strlen(argv[4]);
+        auto [parsed, error] = std::from_chars(argv[4], end, threads);
+        if (error != std::errc() || parsed != end)
+        {
+            std::cerr << "Invalid thread count: " << argv[4] << "\n" << usage;
+            return 1;
+        }
+    }
+
+    TreeManager manager;
+    manager.loadFromFile(argv[3]);
+    if (!manager.snapshot()) return 1;
+
+    try
+    {
+        TreeServer server(argv[2], [&manager]() { return manager.snapshot(); }, threads);
+        server.start();
+
+        activeServer = &server;
+        std::signal(SIGINT, stopServer);
+        std::signal(SIGTERM, stopServer);
+
+        std::cout << "\nServing " << argv[3] << " on " << server.getPath() << " with "
+                  << server.threadCount() << " worker threads\n";
+        server.run();
+        activeServer = nullptr;
+
+        std::cout << "\nServer stopped after " << server.requestsServed() << " requests\n";
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc >= 2 && std::string(argv[1]) == "--serve") return serve(argc, argv);
+
     TreeManager manager;
     int choice;
 
@@ -385,6 +1260,165 @@ int main()
                 manager.searchInRBTree();
                 break;
 
+            case 9:
+            {
+                std::cout << "\nEnter filename: ";
+                std::string filename;
+                std::cin >> filename;
+                manager.reloadFromFile(filename);
+                break;
+            }
+
+            case 10:
+            {
+                std::cout << "\nEnter filename: ";
+                std::string filename;
+                std::cin >> filename;
+                manager.loadInBackground(filename);
+                break;
+            }
+
+            case 11:
+            {
+                if (manager.isWatching())
+                {
+                    manager.stopWatching();
+                    break;
+                }
+                std::cout << "\nEnter filename: ";
+                std::string filename;
+                std::cin >> filename;
+                manager.watchFile(filename);
+                break;
+            }
+
+            case 12:
+            {
+                std::cout << "\nEnter directory: ";
+                std::string directory;
+                std::cin >> directory;
+                manager.loadDirectory(directory);
+                break;
+            }
+
+            case 13:
+            {
+                manager.listWorkspace();
+                std::cout << "\nEnter tree name: ";
+                std::string name;
+                std::cin >> name;
+                manager.selectTree(name);
+                break;
+            }
+
+            case 14:
+                manager.toggleCountedMode();
+                break;
+
+            case 15:
+                manager.rankInRBTree();
+                break;
+
+            case 16:
+            {
+                std::cout << "\nEnter filename: ";
+                std::string filename;
+                std::cin >> filename;
+                manager.openLazily(filename);
+                break;
+            }
+
+            case 17:
+            {
+                std::cout << "\nEnter number of levels: ";
+                int levels;
+                std::cin >> levels;
+                if (std::cin.fail() || levels < 0)
+                {
+                    std::cin.clear();
+                    std::cin.ignore(10000, '\n');
+                    std::cout << "\nInvalid input!\n";
+                    break;
+                }
+                manager.visualizeBinaryTree(levels);
+                break;
+            }
+
+            case 18:
+                manager.toggleSharedMode();
+                break;
+
+            case 19:
+                manager.rangeQueryInRBTree();
+                break;
+
+            case 20:
+            {
+                std::cout << "\nEnter filename: ";
+                std::string filename;
+                std::cin >> filename;
+                manager.loadIntervals(filename);
+                break;
+            }
+
+            case 21:
+                manager.findOverlaps();
+                break;
+
+            case 22:
+                manager.memoryReport();
+                break;
+
+            case 23:
+            {
+                std::cout << "\nEnter filename: ";
+                std::string filename;
+                std::cin >> filename;
+                manager.dumpMemoryReport(filename);
+                break;
+            }
+
+            case 24:
+            {
+                std::string which;
+                std::string format;
+                std::string filename;
+                std::cout << "\nEnter tree (binary/rb): ";
+                std::cin >> which;
+                std::cout << "Enter format (dot/json/csv): ";
+                std::cin >> format;
+                std::cout << "Enter output filename: ";
+                std::cin >> filename;
+                manager.exportTree(which, format, filename);
+                break;
+            }
+
+            case 25:
+            {
+                if (manager.isLogging())
+                {
+                    manager.stopOperationLog();
+                    break;
+                }
+                std::cout << "\nEnter log directory: ";
+                std::string directory;
+                std::cin >> directory;
+                manager.startOperationLog(directory);
+                break;
+            }
+
+            case 26:
+                manager.toggleRBOnlyMode();
+                break;
+
+            case 27:
+                manager.toggleLookupCache();
+                break;
+
+            case 28:
+                manager.toggleMembershipFilter();
+                break;
+
             default:
                 std::cout << "\nInvalid choice! Please try again.\n";
         }